@@ -0,0 +1,430 @@
+// Math Library Benchmark & Accuracy Harness
+//
+// Measures the throughput of every vec/mat operation per dimension and type
+// and checks float results against a double-precision reference. Exits with
+// a non-zero status if any operation exceeds its error tolerance.
+//
+// usage: bench_math [filter]
+
+#include <math/frustum.hpp>
+#include <math/mat.hpp>
+#include <math/vec_soa.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Elements per batch (fits in L1/L2, so this measures compute, not memory)
+const size_t N = 4096;
+
+// Minimum measured time per operation
+const double MIN_SECONDS = 0.05;
+
+static const char *filter = nullptr;
+static int failures = 0;
+
+// Keep the compiler from discarding benchmarked results
+template <typename X> inline void keep(const X &x) {
+  asm volatile("" : : "g"(&x) : "memory");
+}
+
+template <typename T> const char *typeName();
+template <> const char *typeName<float>() { return "float"; }
+template <> const char *typeName<double>() { return "double"; }
+template <> const char *typeName<int>() { return "int"; }
+
+// Random Inputs (magnitudes in [0.5, 10] so division stays well conditioned)
+template <uint8_t D, typename T> std::vector<vec<D, T>> randomVecs() {
+  static std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> dist(0.5, 10.0);
+
+  std::vector<vec<D, T>> out(N);
+  for (auto &v : out)
+    for (uint8_t i = 0; i < D; i++)
+      v.data[i] = static_cast<T>(rng() % 2 ? dist(rng) : -dist(rng));
+  return out;
+}
+
+template <uint8_t D, typename T> std::vector<mat<D, D, T>> randomMats() {
+  auto rows = randomVecs<D, T>();
+
+  std::vector<mat<D, D, T>> out(N);
+  for (size_t i = 0; i < N; i++)
+    for (uint8_t r = 0; r < D; r++)
+      for (uint8_t c = 0; c < D; c++)
+        out[i].data[r][c] = rows[(i + r) % N].data[c];
+  return out;
+}
+
+// Error relative to max(|reference|, 1)
+inline double error(double value, double reference) {
+  return std::fabs(value - reference) / std::max(std::fabs(reference), 1.0);
+}
+
+template <uint8_t D, typename T, typename R>
+double error(const vec<D, T> &value, const vec<D, R> &reference) {
+  double out = 0;
+  for (uint8_t i = 0; i < D; i++)
+    out = std::max(out, error(value.data[i], reference.data[i]));
+  return out;
+}
+
+template <uint8_t Ro, uint8_t Co, typename T, typename R>
+double error(const mat<Ro, Co, T> &value, const mat<Ro, Co, R> &reference) {
+  double out = 0;
+  for (uint8_t r = 0; r < Ro; r++)
+    for (uint8_t c = 0; c < Co; c++)
+      out = std::max(out, error(value.data[r][c], reference.data[r][c]));
+  return out;
+}
+
+// Runs body() (one batch of N operations) until MIN_SECONDS have passed
+template <typename F> double nsPerOp(F body) {
+  using clock = std::chrono::steady_clock;
+
+  body(); // warm up
+
+  size_t batches = 0;
+  auto start = clock::now();
+  double seconds = 0;
+  do {
+    body();
+    batches++;
+    seconds = std::chrono::duration<double>(clock::now() - start).count();
+  } while (seconds < MIN_SECONDS);
+
+  return seconds * 1e9 / (batches * N);
+}
+
+void report(const char *op, int dim, const char *type, double ns,
+            double err = -1, double tolerance = 0) {
+  bool failed = err > tolerance;
+  failures += failed;
+
+  printf("%-22s %3d  %-7s %9.3f ns", op, dim, type, ns);
+  if (err >= 0)
+    printf("   err %.2e%s", err, failed ? "  FAILED" : "");
+  printf("\n");
+}
+
+bool selected(const char *op) { return !filter || strstr(op, filter); }
+
+// Binary vec operation: op(a, b) is a generic lambda, so the same code runs
+// on the benchmarked type and on the double reference
+template <uint8_t D, typename T, typename Op>
+void vecOp(const char *name, Op op, double tolerance) {
+  if (!selected(name))
+    return;
+
+  auto a = randomVecs<D, T>(), b = randomVecs<D, T>();
+
+  double ns = nsPerOp([&] {
+    for (size_t i = 0; i < N; i++)
+      keep(op(a[i], b[i]));
+  });
+
+  double err = -1;
+  if (!std::is_same_v<T, int>) {
+    err = 0;
+    for (size_t i = 0; i < N; i++)
+      err = std::max(err, error(op(a[i], b[i]), op(vec<D, double>(a[i]),
+                                                     vec<D, double>(b[i]))));
+  }
+
+  report(name, D, typeName<T>(), ns, err, tolerance);
+}
+
+template <uint8_t D, typename T, typename Op>
+void matOp(const char *name, Op op, double tolerance) {
+  if (!selected(name))
+    return;
+
+  auto a = randomMats<D, T>(), b = randomMats<D, T>();
+  auto v = randomVecs<D, T>();
+
+  double ns = nsPerOp([&] {
+    for (size_t i = 0; i < N; i++)
+      keep(op(a[i], b[i], v[i]));
+  });
+
+  double err = 0;
+  for (size_t i = 0; i < N; i++)
+    err = std::max(err, error(op(a[i], b[i], v[i]),
+                              op(mat<D, D, double>(a[i]),
+                                 mat<D, D, double>(b[i]),
+                                 vec<D, double>(v[i]))));
+
+  report(name, D, typeName<T>(), ns, err, tolerance);
+}
+
+template <uint8_t D, typename T> void benchVec() {
+  const double eps = std::is_same_v<T, float> ? 1e-5 : 1e-12;
+
+  vecOp<D, T>("vec add", [](auto a, auto b) { return a + b; }, eps);
+  vecOp<D, T>("vec sub", [](auto a, auto b) { return a - b; }, eps);
+  vecOp<D, T>("vec mul", [](auto a, auto b) { return a * b; }, eps);
+  vecOp<D, T>("vec scale", [](auto a, auto b) { return a * b.data[0]; },
+              eps);
+
+  if constexpr (std::is_same_v<T, int>) {
+    vecOp<D, T>("vec dot", [](auto a, auto b) { return vec<D, T>::dot(a, b); },
+                eps);
+    return;
+  }
+
+  using namespace policy;
+
+  vecOp<D, T>("vec div", [](auto a, auto b) { return a / b; }, eps);
+  vecOp<D, T>(
+      "vec dot",
+      [](auto a, auto b) { return decltype(a)::dot(a, b) / 100; }, eps);
+  vecOp<D, T>(
+      "vec dot (fast)",
+      [](auto a, auto b) {
+        return decltype(a)::template dot<fast>(a, b) / 100;
+      },
+      eps);
+  vecOp<D, T>("vec length", [](auto a, auto) { return a.length(); }, eps);
+  vecOp<D, T>(
+      "vec length (fast)",
+      [](auto a, auto) { return a.template length<fast>(); }, 1e-5);
+  vecOp<D, T>("vec normalize", [](auto a, auto) { return a.normalize(); },
+              eps);
+  vecOp<D, T>(
+      "vec normalize (fast)",
+      [](auto a, auto) { return a.template normalize<fast>(); }, 1e-5);
+  vecOp<D, T>(
+      "vec distance",
+      [](auto a, auto b) { return decltype(a)::distance(a, b); }, eps);
+  vecOp<D, T>(
+      "vec lerp",
+      [](auto a, auto b) { return decltype(a)::lerp(a, b, 0.3f); }, eps);
+  vecOp<D, T>(
+      "vec lerp (fast)",
+      [](auto a, auto b) {
+        return decltype(a)::template lerp<fast>(a, b, 0.3f);
+      },
+      eps);
+  vecOp<D, T>(
+      "vec clamp",
+      [](auto a, auto b) { return a.clamp(b * 0.5f, b * 2.0f); }, eps);
+
+  if constexpr (D == 3)
+    vecOp<D, T>(
+        "vec cross",
+        [](auto a, auto b) {
+          // cross always yields vec<3> (float), so spell out the reference
+          if constexpr (std::is_same_v<decltype(a), vec<3, double>>)
+            return vec<3, double>(a[1] * b[2] - a[2] * b[1],
+                                  a[2] * b[0] - a[0] * b[2],
+                                  a[0] * b[1] - a[1] * b[0]) /
+                   100.0;
+          else
+            return vec<3>::cross(a, b) / 100.0f;
+        },
+        1e-5);
+}
+
+template <uint8_t D, typename T> void benchMat() {
+  const double eps = std::is_same_v<T, float> ? 1e-4 : 1e-12;
+
+  matOp<D, T>("mat add", [](auto a, auto b, auto) { return a + b; }, eps);
+  matOp<D, T>("mat sub", [](auto a, auto b, auto) { return a - b; }, eps);
+  matOp<D, T>("mat mul", [](auto a, auto b, auto) { return a * b; }, eps);
+  matOp<D, T>("mat * vec", [](auto a, auto, auto v) { return a * v; }, eps);
+}
+
+void benchTransforms() {
+  std::vector<float> angles(N);
+  for (size_t i = 0; i < N; i++)
+    angles[i] = i * 0.001f;
+
+  struct Transform {
+    const char *name;
+    mat<4> (*f)(float);
+  };
+
+  const Transform transforms[] = {
+      {"mat identity", [](float) { return mat<4>::identity(); }},
+      {"mat rotationX", [](float a) { return mat<4>::rotationX(a); }},
+      {"mat rotation",
+       [](float a) { return mat<4>::rotation(vec<3>(a, a * 2, a * 3)); }},
+      {"mat translation",
+       [](float a) { return mat<4>::translation(vec<3>(a, 1, 2)); }},
+      {"mat scale", [](float a) { return mat<4>::scale(vec<3>(a, 1, 2)); }},
+      {"mat ortho",
+       [](float a) { return mat<4>::ortho(-a, a, -1, 1, 0.1f, 100); }},
+      {"mat lookat",
+       [](float a) {
+         return mat<4>::lookat(vec<3>(a, 4, 10), vec<3>(0, 0, 0));
+       }},
+  };
+
+  for (const auto &t : transforms) {
+    if (!selected(t.name))
+      continue;
+
+    double ns = nsPerOp([&] {
+      for (size_t i = 0; i < N; i++)
+        keep(t.f(angles[i]));
+    });
+    report(t.name, 4, "float", ns);
+  }
+
+  // perspective works in float (with the series tangent when constant
+  // evaluated), so check both against a double-precision reference
+  if (selected("mat perspective")) {
+    double ns = nsPerOp([&] {
+      for (size_t i = 0; i < N; i++)
+        keep(mat<4>::perspective(0.5f + angles[i], 1.5f, 0.1f, 100));
+    });
+
+    double err = 0;
+    for (size_t i = 0; i < N; i++) {
+      float fov = 0.5f + angles[i];
+      double reference = 1.0 / std::tan(double(fov) / 2.0);
+
+      mat<4> m = mat<4>::perspective(fov, 1.5f, 0.1f, 100);
+      err = std::max({err, error(m(1, 1), reference),
+                      error(m(0, 0), reference / 1.5),
+                      error(1.0 / __mat::tan(double(fov) / 2.0), reference)});
+    }
+    report("mat perspective", 4, "float", ns, err, 1e-6);
+  }
+}
+
+// SoA bulk operations, reported per element (compare with the AoS rows)
+void benchSoA() {
+  auto a = randomVecs<3, float>(), b = randomVecs<3, float>();
+  auto sa = vec_soa<3>::gather(a.data(), N);
+  auto sb = vec_soa<3>::gather(b.data(), N);
+  vec_soa<3> out;
+  std::vector<float> dots(N);
+
+  if (selected("soa add"))
+    report("soa add", 3, "float",
+           nsPerOp([&] { vec_soa<3>::add(sa, sb, out); }));
+  if (selected("soa scale"))
+    report("soa scale", 3, "float",
+           nsPerOp([&] { vec_soa<3>::scale(sa, 2.0f, out); }));
+  if (selected("soa lerp"))
+    report("soa lerp", 3, "float",
+           nsPerOp([&] { vec_soa<3>::lerp(sa, sb, 0.3f, out); }));
+
+  if (selected("soa dot")) {
+    double ns = nsPerOp([&] { vec_soa<3>::dot(sa, sb, dots.data()); });
+
+    double err = 0;
+    for (size_t i = 0; i < N; i++)
+      err = std::max(err, error(dots[i] / 100,
+                                vec<3, double>::dot(a[i], b[i]) / 100));
+    report("soa dot", 3, "float", ns, err, 1e-5);
+  }
+
+  for (bool fast : {false, true}) {
+    const char *name = fast ? "soa normalize (fast)" : "soa normalize";
+    if (!selected(name))
+      continue;
+
+    double ns = nsPerOp([&] {
+      if (fast)
+        vec_soa<3>::normalize<policy::fast>(sa, out);
+      else
+        vec_soa<3>::normalize(sa, out);
+    });
+
+    double err = 0;
+    for (size_t i = 0; i < N; i++)
+      err = std::max(err, error(out[i], vec<3, double>(a[i]).normalize()));
+    report(name, 3, "float", ns, err, 1e-5);
+  }
+
+  if (selected("soa min/max")) {
+    double ns = nsPerOp([&] {
+      keep(sa.min());
+      keep(sa.max());
+    });
+
+    vec<3> min(1e30f), max(-1e30f);
+    for (const auto &v : a)
+      for (uint8_t c = 0; c < 3; c++) {
+        min.data[c] = std::min(min.data[c], v.data[c]);
+        max.data[c] = std::max(max.data[c], v.data[c]);
+      }
+    report("soa min/max", 3, "float", ns,
+           std::max(error(sa.min(), min), error(sa.max(), max)), 0);
+  }
+}
+
+// Frustum culling, reported per bound
+void benchFrustum() {
+  frustum f = frustum::fromViewProjection(
+      mat<4>::lookat(vec<3>(0, 0, 20), vec<3>(0, 0, 0)) *
+      mat<4>::perspective(1.0f, 1.5f, 0.1f, 100));
+
+  auto centers = vec_soa<3>::gather(randomVecs<3, float>().data(), N);
+  auto extents = vec_soa<3>::gather(randomVecs<3, float>().data(), N);
+  vec_soa<3>::scale(extents, 0.1f, extents);
+
+  vec_soa<3> min, max;
+  vec_soa<3>::add(centers, extents, max);
+  vec_soa<3>::scale(extents, -1, extents);
+  vec_soa<3>::add(centers, extents, min);
+
+  std::vector<float> radius(N, 0.5f);
+
+  for (bool spheres : {true, false}) {
+    const char *name = spheres ? "frustum spheres" : "frustum aabbs";
+    if (!selected(name))
+      continue;
+
+    auto cull = [&] {
+      return spheres ? f.cullSpheres(centers.data[0], centers.data[1],
+                                     centers.data[2], radius.data(), N)
+                     : f.cullAABBs(min.data[0], min.data[1], min.data[2],
+                                   max.data[0], max.data[1], max.data[2], N);
+    };
+
+    double ns = nsPerOp([&] { keep(cull()); });
+
+    // Compare the visible indices against the scalar per-bound tests
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < N; i++)
+      if (spheres ? f.containsSphere(centers[i], radius[i])
+                  : f.containsAABB(min[i], max[i]))
+        expected.push_back(i);
+    report(name, 3, "float", ns, cull() != expected, 0);
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1)
+    filter = argv[1];
+
+  printf("%-22s %3s  %-7s %12s\n", "operation", "dim", "type", "time/op");
+
+  benchVec<2, float>();
+  benchVec<3, float>();
+  benchVec<4, float>();
+  benchVec<2, double>();
+  benchVec<3, double>();
+  benchVec<4, double>();
+  benchVec<3, int>();
+
+  benchMat<2, float>();
+  benchMat<3, float>();
+  benchMat<4, float>();
+  benchMat<4, double>();
+
+  benchTransforms();
+  benchSoA();
+  benchFrustum();
+
+  if (failures)
+    printf("\n%d operation(s) exceeded their error tolerance\n", failures);
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
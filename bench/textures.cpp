@@ -0,0 +1,99 @@
+// Texture Decode Benchmark
+//
+// Decodes every PNG/JPEG/TGA/BMP in a directory with ImageDecoder, once on
+// a single thread and then on 2, 4, ... up to every hardware thread, into
+// one preallocated buffer (as loading does into staging memory). Reports
+// textures/s and decoded MB/s for each thread count.
+//
+// usage: bench_textures <directory> [repeats]
+
+#include <types/decode.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+static bool isImage(const std::filesystem::path &path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+         extension == ".tga" || extension == ".bmp";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: bench_textures <directory> [repeats]\n");
+    return EXIT_FAILURE;
+  }
+
+  int repeats = argc > 2 ? std::max(atoi(argv[2]), 1) : 3;
+
+  std::vector<ImageDecoder::Job> jobs;
+  for (const auto &entry : std::filesystem::directory_iterator(argv[1]))
+    if (entry.is_regular_file() && isImage(entry.path())) {
+      jobs.emplace_back();
+      jobs.back().path = entry.path().string();
+    }
+
+  ImageDecoder::probe(jobs);
+  jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                            [](const ImageDecoder::Job &job) {
+                              return !job.valid;
+                            }),
+             jobs.end());
+
+  if (jobs.empty()) {
+    fprintf(stderr, "no images in %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  // One destination for the whole batch (like a staging ring)
+  size_t total = 0;
+  for (const ImageDecoder::Job &job : jobs)
+    total += job.size();
+
+  std::vector<uint8_t> destination(total);
+  for (size_t i = 0, offset = 0; i < jobs.size(); offset += jobs[i++].size())
+    jobs[i].dst = &destination[offset];
+
+  printf("%zu image(s), %.1f MB decoded\n\n", jobs.size(), total / 1048576.0);
+  printf("%7s %12s %10s %8s\n", "threads", "textures/s", "MB/s", "speedup");
+
+  size_t hardware = std::max(std::thread::hardware_concurrency(), 1u);
+  double single = 0;
+
+  for (size_t threads = 1;; threads = std::min(threads * 2, hardware)) {
+    // Best of a few runs (the first one also warms the file cache)
+    double best = 1e30;
+    for (int run = 0; run < repeats; run++) {
+      auto start = std::chrono::steady_clock::now();
+      ImageDecoder::decode(jobs, threads);
+      best = std::min(best, std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count());
+    }
+
+    for (const ImageDecoder::Job &job : jobs)
+      if (!job.decoded)
+        fprintf(stderr, "failed to decode %s\n", job.path.c_str());
+
+    if (threads == 1)
+      single = best;
+
+    printf("%7zu %12.1f %10.1f %7.2fx\n", threads, jobs.size() / best,
+           total / 1048576.0 / best, single / best);
+
+    if (threads == hardware)
+      break;
+  }
+
+  return EXIT_SUCCESS;
+}
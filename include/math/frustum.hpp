@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "mat.hpp"
+#include "simd.hpp"
+
+// View Frustum
+// (6 normalized planes, normals point inwards: left, right, bottom, top,
+// near, far)
+struct frustum {
+  vec<4> planes[6];
+
+  // Functions (Static)
+
+  static frustum fromViewProjection(mat<4> m);
+
+  // Functions (Instance Methods)
+
+  bool containsSphere(vec<3> center, float radius) const;
+  bool containsAABB(vec<3> min, vec<3> max) const;
+
+  // Batched Culling (SoA bounds, returns indices of visible bounds)
+
+  std::vector<uint32_t> cullSpheres(const float *x, const float *y,
+                                    const float *z, const float *radius,
+                                    uint32_t count) const;
+
+  std::vector<uint32_t> cullAABBs(const float *minX, const float *minY,
+                                  const float *minZ, const float *maxX,
+                                  const float *maxY, const float *maxZ,
+                                  uint32_t count) const;
+};
+
+// Functions (Static)
+
+// Gribb/Hartmann plane extraction
+inline frustum frustum::fromViewProjection(mat<4> m) {
+  frustum out;
+
+  // Points are transformed as rows (translation lives in data[3]), so the
+  // clip-space components are the columns of the matrix
+  vec<4> col[4];
+  for (uint8_t c = 0; c < 4; c++)
+    col[c] = vec<4>(m.data[0][c], m.data[1][c], m.data[2][c], m.data[3][c]);
+
+  out.planes[0] = col[3] + col[0];
+  out.planes[1] = col[3] - col[0];
+  out.planes[2] = col[3] + col[1];
+  out.planes[3] = col[3] - col[1];
+  out.planes[4] = col[3] + col[2];
+  out.planes[5] = col[3] - col[2];
+
+  for (auto &plane : out.planes) {
+    float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] +
+                         plane[2] * plane[2]);
+    plane = plane / length;
+  }
+
+  return out;
+}
+
+// Functions (Instance Methods)
+
+inline bool frustum::containsSphere(vec<3> center, float radius) const {
+  for (const auto &p : planes)
+    if (p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3] <
+        -radius)
+      return false;
+  return true;
+}
+
+inline bool frustum::containsAABB(vec<3> min, vec<3> max) const {
+  for (const auto &p : planes) {
+    // Test the corner furthest along the plane normal
+    float x = p[0] > 0 ? max[0] : min[0];
+    float y = p[1] > 0 ? max[1] : min[1];
+    float z = p[2] > 0 ? max[2] : min[2];
+
+    if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0)
+      return false;
+  }
+  return true;
+}
+
+// Batched Culling
+
+inline std::vector<uint32_t>
+frustum::cullSpheres(const float *x, const float *y, const float *z,
+                     const float *radius, uint32_t count) const {
+  std::vector<uint32_t> visible;
+  visible.reserve(count);
+
+  __simd::f32 plane[6][4];
+  for (uint8_t p = 0; p < 6; p++)
+    for (uint8_t c = 0; c < 4; c++)
+      plane[p][c] = __simd::set(planes[p][c]);
+
+  const __simd::f32 zero = __simd::set(0.0f);
+
+  uint32_t i = 0;
+  for (; i + __simd::width <= count; i += __simd::width) {
+    __simd::f32 px = __simd::load(x + i);
+    __simd::f32 py = __simd::load(y + i);
+    __simd::f32 pz = __simd::load(z + i);
+    __simd::f32 r = __simd::load(radius + i);
+
+    uint32_t mask = __simd::full;
+    for (uint8_t p = 0; p < 6 && mask; p++) {
+      __simd::f32 d = __simd::madd(
+          px, plane[p][0],
+          __simd::madd(py, plane[p][1],
+                       __simd::madd(pz, plane[p][2], plane[p][3])));
+      mask &= __simd::ge(__simd::add(d, r), zero);
+    }
+
+    // Compact Visible Lanes
+    for (; mask; mask &= mask - 1)
+      visible.push_back(i + __builtin_ctz(mask));
+  }
+
+  for (; i < count; i++)
+    if (containsSphere(vec<3>(x[i], y[i], z[i]), radius[i]))
+      visible.push_back(i);
+
+  return visible;
+}
+
+inline std::vector<uint32_t>
+frustum::cullAABBs(const float *minX, const float *minY, const float *minZ,
+                   const float *maxX, const float *maxY, const float *maxZ,
+                   uint32_t count) const {
+  std::vector<uint32_t> visible;
+  visible.reserve(count);
+
+  // The corner furthest along each plane normal only depends on the plane,
+  // so pick its streams once instead of blending per box
+  const float *corner[6][3];
+  __simd::f32 plane[6][4];
+  for (uint8_t p = 0; p < 6; p++) {
+    corner[p][0] = planes[p][0] > 0 ? maxX : minX;
+    corner[p][1] = planes[p][1] > 0 ? maxY : minY;
+    corner[p][2] = planes[p][2] > 0 ? maxZ : minZ;
+
+    for (uint8_t c = 0; c < 4; c++)
+      plane[p][c] = __simd::set(planes[p][c]);
+  }
+
+  const __simd::f32 zero = __simd::set(0.0f);
+
+  uint32_t i = 0;
+  for (; i + __simd::width <= count; i += __simd::width) {
+    uint32_t mask = __simd::full;
+    for (uint8_t p = 0; p < 6 && mask; p++) {
+      __simd::f32 d = __simd::madd(
+          __simd::load(corner[p][0] + i), plane[p][0],
+          __simd::madd(__simd::load(corner[p][1] + i), plane[p][1],
+                       __simd::madd(__simd::load(corner[p][2] + i),
+                                    plane[p][2], plane[p][3])));
+      mask &= __simd::ge(d, zero);
+    }
+
+    // Compact Visible Lanes
+    for (; mask; mask &= mask - 1)
+      visible.push_back(i + __builtin_ctz(mask));
+  }
+
+  for (; i < count; i++)
+    if (containsAABB(vec<3>(minX[i], minY[i], minZ[i]),
+                     vec<3>(maxX[i], maxY[i], maxZ[i])))
+      visible.push_back(i);
+
+  return visible;
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <type_traits>
 #include <vector>
 
 #include "vec.hpp"
@@ -15,6 +17,41 @@
 #define MIN(a, b) (a < b ? a : b)
 #define MAX(a, b) (a < b ? b : a)
 
+namespace __mat {
+
+// Compile-Time Tangent
+// (std::tan is not constexpr; accurate to double precision in [-pi, pi])
+constexpr double tan(double x) {
+  const double pi = 3.14159265358979323846;
+
+  // Reduce to [-pi, pi]
+  double turns = x / (2.0 * pi);
+  x -= 2.0 * pi * (long long)(turns + (turns < 0 ? -0.5 : 0.5));
+
+  // Taylor Series
+  double sin = 0, cos = 0, term = 1;
+  for (int n = 0; n < 32; n++) {
+    if (n % 2)
+      sin += n % 4 == 1 ? term : -term;
+    else
+      cos += n % 4 == 0 ? term : -term;
+    term *= x / (n + 1);
+  }
+
+  return sin / cos;
+}
+
+// Whether the caller is being evaluated at compile time
+constexpr bool constant() {
+#if defined(__cpp_lib_is_constant_evaluated)
+  return std::is_constant_evaluated();
+#else
+  return __builtin_is_constant_evaluated();
+#endif
+}
+
+} // namespace __mat
+
 // Variable Dimension Matrix
 template <uint8_t R, uint8_t C = R, typename T = float> struct mat {
   static_assert(R != 0 && C != 0, "Null-Matrices are not supported");
@@ -23,65 +60,70 @@ template <uint8_t R, uint8_t C = R, typename T = float> struct mat {
 
   // Constructors & Destructor
 
-  mat(T v = 0);
+  constexpr mat(T v = 0);
   mat(std::vector<std::vector<T>> m);
-  template <uint8_t inR, uint8_t inC, typename inT> mat(mat<inR, inC, inT> m);
+  template <uint8_t inR, uint8_t inC, typename inT>
+  constexpr mat(mat<inR, inC, inT> m);
 
-  ~mat();
+  ~mat() = default;
 
   // Arithmetic Operators
 
-  mat<R, C, T> operator+(mat<R, C, T> m) const;
-  mat<R, C, T> operator-(mat<R, C, T> m) const;
+  constexpr mat<R, C, T> operator+(mat<R, C, T> m) const;
+  constexpr mat<R, C, T> operator-(mat<R, C, T> m) const;
   // matrix division is not defined
   template <uint8_t inR, uint8_t inC, typename inT>
-  mat<MAX(R, inR), MAX(C, inC)> operator*(mat<inR, inC, inT> m) const;
+  constexpr mat<MAX(R, inR), MAX(C, inC), T>
+  operator*(mat<inR, inC, inT> m) const;
 
+  // Transforms v the way the shaders do (vectors shorter than the matrix are
+  // extended as homogeneous points)
   template <uint8_t inD, typename inT>
-  vec<inD, inT> operator*(vec<inD, inT> v) const;
+  constexpr vec<inD, inT> operator*(vec<inD, inT> v) const;
 
   // Assignment Operators
 
   template <uint8_t inR, uint8_t inC, typename inT>
-  void operator=(mat<inR, inC, inT> m);
+  constexpr void operator=(mat<inR, inC, inT> m);
   template <uint8_t inR, uint8_t inC, typename inT>
-  void operator*=(mat<inR, inC, inT> m);
+  constexpr void operator*=(mat<inR, inC, inT> m);
 
   // Relational Operators
 
   template <uint8_t inR, uint8_t inC, typename inT>
-  bool operator==(mat<inR, inC, inT> m) const;
+  constexpr bool operator==(mat<inR, inC, inT> m) const;
   template <uint8_t inR, uint8_t inC, typename inT>
-  bool operator!=(mat<inR, inC, inT> m) const;
+  constexpr bool operator!=(mat<inR, inC, inT> m) const;
 
   // Other Operators
 
-  T operator()(uint8_t row, uint8_t col) const;
-  T &operator()(uint8_t row, uint8_t col);
+  constexpr T operator()(uint8_t row, uint8_t col) const;
+  constexpr T &operator()(uint8_t row, uint8_t col);
 
   // Functions (Instance Methods)
 
-  bool isSquare() const;
+  constexpr bool isSquare() const;
   void inverse();
 
   // Functions (Static)
 
-  static mat<R> identity();
+  static constexpr mat<R, R, T> identity();
 
   static mat<4> rotationX(float rad);
   static mat<4> rotationY(float rad);
   static mat<4> rotationZ(float rad);
   static mat<4> rotation(vec<3> rad);
 
-  static mat<4> translation(vec<3> v);
-  static mat<4> scale(vec<3> v);
+  static constexpr mat<4> translation(vec<3> v);
+  static constexpr mat<4> scale(vec<3> v);
 
   // Functions (Dimension-Specific)
 
-  static mat<4> perspective(float fovrads, float aspect, float near, float far);
+  static constexpr mat<4> perspective(float fovrads, float aspect, float near,
+                                      float far);
 
-  static mat<4> ortho(float left, float right, float bottom, float top,
-                      float fnear, float ffar);
+  static constexpr mat<4> ortho(float left, float right, float bottom,
+                                float top, float fnear, float ffar);
 
   static mat<4> lookat(vec<3> pos, vec<3> target,
                        vec<3> up = {0.0f, 1.0f, 0.0f});
@@ -89,7 +131,8 @@ template <uint8_t R, uint8_t C = R, typename T = float> struct mat {
 
 // Constructors & Destructor
 
-template <uint8_t R, uint8_t C, typename T> mat<R, C, T>::mat(T v) {
+template <uint8_t R, uint8_t C, typename T>
+constexpr mat<R, C, T>::mat(T v) : data{} {
   for (int r = 0; r < R; r++)
     for (int c = 0; c < C; c++)
       this->data[r][c] = v;
@@ -104,16 +147,14 @@ mat<R, C, T>::mat(std::vector<std::vector<T>> m) {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inR, uint8_t inC, typename inT>
-mat<R, C, T>::mat(mat<inR, inC, inT> m) {
+constexpr mat<R, C, T>::mat(mat<inR, inC, inT> m) : data{} {
   *this = m;
 }
 
-template <uint8_t R, uint8_t C, typename T> mat<R, C, T>::~mat() {}
-
 // Arithmetic Operators
 
 template <uint8_t R, uint8_t C, typename T>
-mat<R, C, T> mat<R, C, T>::operator+(mat<R, C, T> m) const {
+constexpr mat<R, C, T> mat<R, C, T>::operator+(mat<R, C, T> m) const {
   mat<R, C, T> out;
 
   for (uint8_t r = 0; r < R; r++)
@@ -124,7 +165,7 @@ mat<R, C, T> mat<R, C, T>::operator+(mat<R, C, T> m) const {
 }
 
 template <uint8_t R, uint8_t C, typename T>
-mat<R, C, T> mat<R, C, T>::operator-(mat<R, C, T> m) const {
+constexpr mat<R, C, T> mat<R, C, T>::operator-(mat<R, C, T> m) const {
   mat<R, C, T> out;
 
   for (uint8_t r = 0; r < R; r++)
@@ -136,9 +177,9 @@ mat<R, C, T> mat<R, C, T>::operator-(mat<R, C, T> m) const {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inR, uint8_t inC, typename inT>
-mat<MAX(R, inR), MAX(C, inC)>
+constexpr mat<MAX(R, inR), MAX(C, inC), T>
 mat<R, C, T>::operator*(mat<inR, inC, inT> m) const {
-  mat<MAX(R, inR), MAX(C, inC)> out;
+  mat<MAX(R, inR), MAX(C, inC), T> out;
 
   if (C != inR)
     return out;
@@ -153,10 +194,16 @@ mat<R, C, T>::operator*(mat<inR, inC, inT> m) const {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inD, typename inT>
-vec<inD, inT> mat<R, C, T>::operator*(vec<inD, inT> v) const {
+constexpr vec<inD, inT> mat<R, C, T>::operator*(vec<inD, inT> v) const {
   vec<inD, inT> out;
 
-  // TODO
+  // Vectors are rows (translation lives in data[R - 1])
+  for (uint8_t c = 0; c < MIN(C, inD); c++) {
+    inT sum = 0;
+    for (uint8_t r = 0; r < R; r++)
+      sum += this->data[r][c] * (r < inD ? v.data[r] : (r == R - 1 ? 1 : 0));
+    out.data[c] = sum;
+  }
 
   return out;
 }
@@ -165,7 +212,7 @@ vec<inD, inT> mat<R, C, T>::operator*(vec<inD, inT> v) const {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inR, uint8_t inC, typename inT>
-void mat<R, C, T>::operator=(mat<inR, inC, inT> m) {
+constexpr void mat<R, C, T>::operator=(mat<inR, inC, inT> m) {
   for (int r = 0; r < R; r++)
     for (int c = 0; c < C; c++)
       this->data[r][c] = r < inR && c < inC ? m.data[r][c] : 0;
@@ -173,7 +220,7 @@ void mat<R, C, T>::operator=(mat<inR, inC, inT> m) {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inR, uint8_t inC, typename inT>
-void mat<R, C, T>::operator*=(mat<inR, inC, inT> m) {
+constexpr void mat<R, C, T>::operator*=(mat<inR, inC, inT> m) {
   *this = *this * m;
 }
 
@@ -181,7 +228,7 @@ void mat<R, C, T>::operator*=(mat<inR, inC, inT> m) {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inR, uint8_t inC, typename inT>
-bool mat<R, C, T>::operator==(mat<inR, inC, inT> m) const {
+constexpr bool mat<R, C, T>::operator==(mat<inR, inC, inT> m) const {
   for (int r = 0; r < std::min(R, inR); r++)
     for (int c = 0; c < std::min(C, inC); c++)
       if (this->data[r][c] != m.data[r][c])
@@ -191,30 +238,26 @@ bool mat<R, C, T>::operator==(mat<inR, inC, inT> m) const {
 
 template <uint8_t R, uint8_t C, typename T>
 template <uint8_t inR, uint8_t inC, typename inT>
-bool mat<R, C, T>::operator!=(mat<inR, inC, inT> m) const {
-  for (int r = 0; r < std::min(R, inR); r++)
-    for (int c = 0; c < std::min(C, inC); c++)
-      if (this->data[r][c] == m.data[r][c])
-        return false;
-  return true;
+constexpr bool mat<R, C, T>::operator!=(mat<inR, inC, inT> m) const {
+  return !(*this == m);
 }
 
 // Other Operators
 
 template <uint8_t R, uint8_t C, typename T>
-T mat<R, C, T>::operator()(uint8_t row, uint8_t col) const {
+constexpr T mat<R, C, T>::operator()(uint8_t row, uint8_t col) const {
   return this->data[row % R][col % C];
 }
 
 template <uint8_t R, uint8_t C, typename T>
-T &mat<R, C, T>::operator()(uint8_t row, uint8_t col) {
+constexpr T &mat<R, C, T>::operator()(uint8_t row, uint8_t col) {
   return this->data[row % R][col % C];
 }
 
 // Functions (Instance Methods)
 
 template <uint8_t R, uint8_t C, typename T>
-bool mat<R, C, T>::isSquare() const {
+constexpr bool mat<R, C, T>::isSquare() const {
   return R == C;
 }
 
@@ -224,8 +267,9 @@ void inverse();
 
 // Functions (Static)
 
-template <uint8_t R, uint8_t C, typename T> mat<R, R> mat<R, C, T>::identity() {
-  mat<R> out;
+template <uint8_t R, uint8_t C, typename T>
+constexpr mat<R, R, T> mat<R, C, T>::identity() {
+  mat<R, R, T> out;
 
   for (uint8_t rc = 0; rc < MIN(R, C); rc++)
     out.data[rc][rc] = 1;
@@ -284,22 +328,24 @@ mat<4> mat<R, C, T>::rotation(vec<3> rad) {
   return matrix;
 }
 
-template <uint8_t R, uint8_t C, typename T> mat<4> translation(vec<3> v) {
+template <uint8_t R, uint8_t C, typename T>
+constexpr mat<4> mat<R, C, T>::translation(vec<3> v) {
   mat<4> out = mat<4>::identity();
 
-  out.data[3][0] = v->x;
-  out.data[3][1] = v->y;
-  out.data[3][2] = v->z;
+  out.data[3][0] = v.data[0];
+  out.data[3][1] = v.data[1];
+  out.data[3][2] = v.data[2];
 
   return out;
 }
 
-template <uint8_t R, uint8_t C, typename T> mat<4> scale(vec<3> v) {
+template <uint8_t R, uint8_t C, typename T>
+constexpr mat<4> mat<R, C, T>::scale(vec<3> v) {
   mat<4> out;
 
-  out.data[0][0] = v->x;
-  out.data[1][1] = v->y;
-  out.data[2][2] = v->z;
+  out.data[0][0] = v.data[0];
+  out.data[1][1] = v.data[1];
+  out.data[2][2] = v.data[2];
   out.data[3][3] = 1.0f;
 
   return out;
@@ -308,9 +354,11 @@ template <uint8_t R, uint8_t C, typename T> mat<4> scale(vec<3> v) {
 // Functions (Dimension-Specific)
 
 template <uint8_t R, uint8_t C, typename T>
-mat<4> mat<R, C, T>::perspective(float fovrads, float aspect, float near,
-                                 float far) {
-  float tanHalfFov = tan(fovrads / 2.0f);
+constexpr mat<4> mat<R, C, T>::perspective(float fovrads, float aspect,
+                                           float near, float far) {
+  // The series only where std::tan can't be called
+  float tanHalfFov = __mat::constant() ? float(__mat::tan(fovrads / 2.0f))
+                                       : std::tan(fovrads / 2.0f);
 
   mat<4> out;
   out.data[0][0] = 1.0f / (aspect * tanHalfFov);
@@ -322,8 +370,8 @@ mat<4> mat<R, C, T>::perspective(float fovrads, float aspect, float near,
 }
 
 template <uint8_t R, uint8_t C, typename T>
-mat<4> mat<R, C, T>::ortho(float left, float right, float bottom, float top,
-                           float near, float far) {
+constexpr mat<4> mat<R, C, T>::ortho(float left, float right, float bottom,
+                                     float top, float near, float far) {
   mat<4> out = identity();
   out.data[0][0] = 2.0f / (right - left);
   out.data[1][1] = 2.0f / (top - bottom);
@@ -354,4 +402,21 @@ mat<4> mat<R, C, T>::lookat(vec<3> pos, vec<3> target, vec<3> up) {
   out.data[3][1] = -vec<3>::dot(u, pos);
   out.data[3][2] = vec<3>::dot(f, pos);
   return out;
-}
\ No newline at end of file
+}
+
+// Compile-Time Checks
+
+static_assert(mat<4>::identity()(3, 3) == 1 && mat<4>::identity()(3, 0) == 0,
+              "mat::identity is not constexpr");
+static_assert((mat<2>(2) + mat<2>(1))(1, 0) == 3,
+              "mat arithmetic is not constexpr");
+static_assert((mat<4>::identity() * mat<4>(2)) == mat<4>(2),
+              "mat multiplication is not constexpr");
+static_assert(mat<4>::translation(vec<3>(1, 2, 3)) * vec<3>(1, 1, 1) ==
+                  vec<3>(2, 3, 4),
+              "mat * vec is not constexpr");
+static_assert(mat<4>::ortho(-2, 2, -1, 1, -1, 1)(0, 0) == 0.5f,
+              "mat::ortho is not constexpr");
+static_assert(mat<4>::perspective(1.5707963f, 1, 1, 3)(1, 1) > 0.9999f &&
+                  mat<4>::perspective(1.5707963f, 1, 1, 3)(1, 1) < 1.0001f,
+              "mat::perspective is not constexpr");
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Packed Float Lanes
+// (widest instruction set enabled at compile time, scalar otherwise)
+//
+// There is no runtime dispatch: a default x86-64 build only gets SSE2 lanes,
+// AVX2 & AVX-512 need the build configured with -DNATIVE_ARCH=ON (and the
+// binary then only runs on CPUs like the one it was built on).
+namespace __simd {
+
+#if defined(__AVX512F__)
+
+typedef __m512 f32;
+constexpr uint8_t width = 16;
+
+inline f32 load(const float *p) { return _mm512_loadu_ps(p); }
+inline f32 loada(const float *p) { return _mm512_load_ps(p); }
+inline void storea(float *p, f32 a) { _mm512_store_ps(p, a); }
+inline f32 set(float v) { return _mm512_set1_ps(v); }
+
+inline f32 add(f32 a, f32 b) { return _mm512_add_ps(a, b); }
+inline f32 sub(f32 a, f32 b) { return _mm512_sub_ps(a, b); }
+inline f32 mul(f32 a, f32 b) { return _mm512_mul_ps(a, b); }
+inline f32 div(f32 a, f32 b) { return _mm512_div_ps(a, b); }
+inline f32 madd(f32 a, f32 b, f32 c) { return _mm512_fmadd_ps(a, b, c); }
+
+inline f32 min(f32 a, f32 b) { return _mm512_min_ps(a, b); }
+inline f32 max(f32 a, f32 b) { return _mm512_max_ps(a, b); }
+inline f32 sqrt(f32 a) { return _mm512_sqrt_ps(a); }
+inline f32 rsqrte(f32 a) { return _mm512_rsqrt14_ps(a); }
+
+// Horizontal Reductions
+inline float hmin(f32 a) { return _mm512_reduce_min_ps(a); }
+inline float hmax(f32 a) { return _mm512_reduce_max_ps(a); }
+
+// Lane Mask (bit i set if a[i] >= b[i])
+inline uint32_t ge(f32 a, f32 b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+}
+
+#elif defined(__AVX__)
+
+typedef __m256 f32;
+constexpr uint8_t width = 8;
+
+inline f32 load(const float *p) { return _mm256_loadu_ps(p); }
+inline f32 loada(const float *p) { return _mm256_load_ps(p); }
+inline void storea(float *p, f32 a) { _mm256_store_ps(p, a); }
+inline f32 set(float v) { return _mm256_set1_ps(v); }
+
+inline f32 add(f32 a, f32 b) { return _mm256_add_ps(a, b); }
+inline f32 sub(f32 a, f32 b) { return _mm256_sub_ps(a, b); }
+inline f32 mul(f32 a, f32 b) { return _mm256_mul_ps(a, b); }
+inline f32 div(f32 a, f32 b) { return _mm256_div_ps(a, b); }
+#ifdef __FMA__
+inline f32 madd(f32 a, f32 b, f32 c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+inline f32 madd(f32 a, f32 b, f32 c) { return add(mul(a, b), c); }
+#endif
+
+inline f32 min(f32 a, f32 b) { return _mm256_min_ps(a, b); }
+inline f32 max(f32 a, f32 b) { return _mm256_max_ps(a, b); }
+inline f32 sqrt(f32 a) { return _mm256_sqrt_ps(a); }
+inline f32 rsqrte(f32 a) { return _mm256_rsqrt_ps(a); }
+
+// Horizontal Reductions
+inline float hmin(f32 a) {
+  __m128 h = _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+  h = _mm_min_ps(h, _mm_movehl_ps(h, h));
+  return _mm_cvtss_f32(_mm_min_ss(h, _mm_shuffle_ps(h, h, 1)));
+}
+inline float hmax(f32 a) {
+  __m128 h = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+  h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+  return _mm_cvtss_f32(_mm_max_ss(h, _mm_shuffle_ps(h, h, 1)));
+}
+
+// Lane Mask (bit i set if a[i] >= b[i])
+inline uint32_t ge(f32 a, f32 b) {
+  return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GE_OQ));
+}
+
+#elif defined(__SSE2__)
+
+typedef __m128 f32;
+constexpr uint8_t width = 4;
+
+inline f32 load(const float *p) { return _mm_loadu_ps(p); }
+inline f32 loada(const float *p) { return _mm_load_ps(p); }
+inline void storea(float *p, f32 a) { _mm_store_ps(p, a); }
+inline f32 set(float v) { return _mm_set1_ps(v); }
+
+inline f32 add(f32 a, f32 b) { return _mm_add_ps(a, b); }
+inline f32 sub(f32 a, f32 b) { return _mm_sub_ps(a, b); }
+inline f32 mul(f32 a, f32 b) { return _mm_mul_ps(a, b); }
+inline f32 div(f32 a, f32 b) { return _mm_div_ps(a, b); }
+inline f32 madd(f32 a, f32 b, f32 c) { return add(mul(a, b), c); }
+
+inline f32 min(f32 a, f32 b) { return _mm_min_ps(a, b); }
+inline f32 max(f32 a, f32 b) { return _mm_max_ps(a, b); }
+inline f32 sqrt(f32 a) { return _mm_sqrt_ps(a); }
+inline f32 rsqrte(f32 a) { return _mm_rsqrt_ps(a); }
+
+// Horizontal Reductions
+inline float hmin(f32 a) {
+  a = _mm_min_ps(a, _mm_movehl_ps(a, a));
+  return _mm_cvtss_f32(_mm_min_ss(a, _mm_shuffle_ps(a, a, 1)));
+}
+inline float hmax(f32 a) {
+  a = _mm_max_ps(a, _mm_movehl_ps(a, a));
+  return _mm_cvtss_f32(_mm_max_ss(a, _mm_shuffle_ps(a, a, 1)));
+}
+
+// Lane Mask (bit i set if a[i] >= b[i])
+inline uint32_t ge(f32 a, f32 b) { return _mm_movemask_ps(_mm_cmpge_ps(a, b)); }
+
+#else
+
+typedef float f32;
+constexpr uint8_t width = 1;
+
+inline f32 load(const float *p) { return *p; }
+inline f32 loada(const float *p) { return *p; }
+inline void storea(float *p, f32 a) { *p = a; }
+inline f32 set(float v) { return v; }
+
+inline f32 add(f32 a, f32 b) { return a + b; }
+inline f32 sub(f32 a, f32 b) { return a - b; }
+inline f32 mul(f32 a, f32 b) { return a * b; }
+inline f32 div(f32 a, f32 b) { return a / b; }
+inline f32 madd(f32 a, f32 b, f32 c) { return a * b + c; }
+
+inline f32 min(f32 a, f32 b) { return a < b ? a : b; }
+inline f32 max(f32 a, f32 b) { return a < b ? b : a; }
+inline f32 sqrt(f32 a) { return std::sqrt(a); }
+inline f32 rsqrte(f32 a) { return 1.0f / std::sqrt(a); }
+
+// Horizontal Reductions
+inline float hmin(f32 a) { return a; }
+inline float hmax(f32 a) { return a; }
+
+// Lane Mask (bit 0 set if a >= b)
+inline uint32_t ge(f32 a, f32 b) { return a >= b; }
+
+#endif
+
+// Mask with one bit set per lane
+constexpr uint32_t full = (1u << width) - 1;
+
+// Reciprocal Square Root (estimate refined by one Newton-Raphson step)
+inline f32 rsqrt(f32 a) {
+  f32 y = rsqrte(a);
+  return mul(y, sub(set(1.5f), mul(mul(set(0.5f), a), mul(y, y))));
+}
+
+} // namespace __simd
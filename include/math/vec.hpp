@@ -3,8 +3,25 @@
 #include <cmath>
 #include <cstdarg>
 #include <cstdint>
+#include <type_traits>
 #include <vector>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// Math Policies (chosen per call, e.g. v.normalize<policy::fast>())
+namespace policy {
+
+// IEEE square roots, separate multiply & add
+struct precise {};
+
+// Reciprocal square root estimate refined by one Newton step, fused
+// multiply-add where the target has it
+struct fast {};
+
+} // namespace policy
+
 // Vector Components
 namespace __vec {
 template <uint8_t D, typename T> struct vecC;
@@ -23,83 +40,91 @@ template <uint8_t D = 3, typename T = float> struct vec {
   // Constructors & Destructor
 
   vec(std::vector<T> v);
-  template <typename... Args> vec(Args... args);
-  template <uint8_t inD, typename inT> vec(vec<inD, inT> v);
+  template <typename... Args> constexpr vec(Args... args);
+  template <uint8_t inD, typename inT> constexpr vec(vec<inD, inT> v);
 
-  ~vec();
+  ~vec() = default;
 
   // Arithmetic Operators
 
   template <uint8_t inD, typename inT>
-  vec<D, T> operator+(const vec<inD, inT> &v) const;
+  constexpr vec<D, T> operator+(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  vec<D, T> operator-(const vec<inD, inT> &v) const;
+  constexpr vec<D, T> operator-(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  vec<D, T> operator*(const vec<inD, inT> &v) const;
+  constexpr vec<D, T> operator*(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  vec<D, T> operator/(const vec<inD, inT> &v) const;
+  constexpr vec<D, T> operator/(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  vec<D, T> operator%(const vec<inD, inT> &v) const;
+  constexpr vec<D, T> operator%(const vec<inD, inT> &v) const;
 
-  vec<D, T> operator*(const T &v) const;
-  vec<D, T> operator/(const T &v) const;
-  vec<D, T> operator%(const T &v) const;
+  constexpr vec<D, T> operator*(const T &v) const;
+  constexpr vec<D, T> operator/(const T &v) const;
+  constexpr vec<D, T> operator%(const T &v) const;
 
   // Assignment Operators
 
-  template <uint8_t inD, typename inT> void operator=(const vec<inD, inT> &v);
-  template <uint8_t inD, typename inT> void operator+=(const vec<inD, inT> &v);
-  template <uint8_t inD, typename inT> void operator-=(const vec<inD, inT> &v);
-  template <uint8_t inD, typename inT> void operator*=(const vec<inD, inT> &v);
-  template <uint8_t inD, typename inT> void operator/=(const vec<inD, inT> &v);
-  template <uint8_t inD, typename inT> void operator%=(const vec<inD, inT> &v);
+  template <uint8_t inD, typename inT>
+  constexpr void operator=(const vec<inD, inT> &v);
+  template <uint8_t inD, typename inT>
+  constexpr void operator+=(const vec<inD, inT> &v);
+  template <uint8_t inD, typename inT>
+  constexpr void operator-=(const vec<inD, inT> &v);
+  template <uint8_t inD, typename inT>
+  constexpr void operator*=(const vec<inD, inT> &v);
+  template <uint8_t inD, typename inT>
+  constexpr void operator/=(const vec<inD, inT> &v);
+  template <uint8_t inD, typename inT>
+  constexpr void operator%=(const vec<inD, inT> &v);
 
-  void operator=(const T &v);
-  void operator*=(const T &v);
-  void operator/=(const T &v);
-  void operator%=(const T &v);
+  constexpr void operator=(const T &v);
+  constexpr void operator*=(const T &v);
+  constexpr void operator/=(const T &v);
+  constexpr void operator%=(const T &v);
 
   // Relational Operators
 
   template <uint8_t inD, typename inT>
-  bool operator==(const vec<inD, inT> &v) const;
+  constexpr bool operator==(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  bool operator!=(const vec<inD, inT> &v) const;
+  constexpr bool operator!=(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  bool operator>(const vec<inD, inT> &v) const;
+  constexpr bool operator>(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  bool operator<(const vec<inD, inT> &v) const;
+  constexpr bool operator<(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  bool operator>=(const vec<inD, inT> &v) const;
+  constexpr bool operator>=(const vec<inD, inT> &v) const;
   template <uint8_t inD, typename inT>
-  bool operator<=(const vec<inD, inT> &v) const;
+  constexpr bool operator<=(const vec<inD, inT> &v) const;
 
   // Other Operators
 
-  T operator[](uint8_t i) const;
-  T &operator[](uint8_t i);
+  constexpr T operator[](uint8_t i) const;
+  constexpr T &operator[](uint8_t i);
 
-  void operator++();
-  void operator--();
+  constexpr void operator++();
+  constexpr void operator--();
 
   __vec::vecC<D, T> *operator->() { return &component; }
   const __vec::vecC<D, T> *operator->() const { return &component; }
 
   // Functions (Instance Methods)
 
-  T length() const;
-  vec normalize() const;
-  vec clamp(vec min, vec max) const;
+  template <typename P = policy::precise> T length() const;
+  template <typename P = policy::precise> vec normalize() const;
+  constexpr vec clamp(vec min, vec max) const;
 
   // Functions (Static)
 
-  static T distance(vec a, vec b);
-  static T dot(vec a, vec b);
-  static vec lerp(vec a, vec b, T blend);
+  template <typename P = policy::precise> static T distance(vec a, vec b);
+  template <typename P = policy::precise>
+  static constexpr T dot(vec a, vec b);
+  template <typename P = policy::precise>
+  static constexpr vec lerp(vec a, vec b, T blend);
 
   // Functions (Dimension-Specific)
 
-  static vec<3> cross(vec<3> a, vec<3> b);
+  static constexpr vec<3> cross(vec<3> a, vec<3> b);
 };
 
 namespace __vec {
@@ -164,6 +189,31 @@ template <typename T> struct vecC<4, T> {
   };
 };
 
+// Multiply-Add (fused when the target has hardware FMA)
+template <typename T> inline T madd(T a, T b, T c) {
+#ifdef FP_FAST_FMAF
+  if constexpr (std::is_same_v<T, float>)
+    return std::fma(a, b, c);
+#endif
+#ifdef FP_FAST_FMA
+  if constexpr (std::is_same_v<T, double>)
+    return std::fma(a, b, c);
+#endif
+  return a * b + c;
+}
+
+// Fast Reciprocal Square Root
+template <typename T> inline T rsqrt(T x) {
+#ifdef __SSE__
+  if constexpr (std::is_same_v<T, float>) {
+    // 12-bit estimate, one Newton-Raphson step brings it to ~23 bits
+    float y = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+    return y * (1.5f - 0.5f * x * y * y);
+  }
+#endif
+  return static_cast<T>(1 / std::sqrt(x));
+}
+
 } // namespace __vec
 
 // Constructors & Destructor
@@ -175,27 +225,27 @@ template <uint8_t D, typename T> vec<D, T>::vec(std::vector<T> v) {
 
 template <uint8_t D, typename T>
 template <typename... Args>
-vec<D, T>::vec(Args... args) {
-  T values[] = {static_cast<T>(args)...};
-  for (uint8_t i = 0; i < D; i++)
-    this->data[i] = sizeof...(args) == 1
-                        ? values[0]
-                        : (i < sizeof...(args) ? values[i] : 0);
+constexpr vec<D, T>::vec(Args... args) : data{} {
+  if constexpr (sizeof...(args) > 0) {
+    const T values[] = {static_cast<T>(args)...};
+    for (uint8_t i = 0; i < D; i++)
+      this->data[i] = sizeof...(args) == 1
+                          ? values[0]
+                          : (i < sizeof...(args) ? values[i] : 0);
+  }
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-vec<D, T>::vec(vec<inD, inT> v) {
+constexpr vec<D, T>::vec(vec<inD, inT> v) : data{} {
   *this = v;
 }
 
-template <uint8_t D, typename T> vec<D, T>::~vec() {}
-
 // Arithmetic Operators
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-vec<D, T> vec<D, T>::operator+(const vec<inD, inT> &v) const {
+constexpr vec<D, T> vec<D, T>::operator+(const vec<inD, inT> &v) const {
   vec<D, T> ret;
   for (uint8_t i = 0; i < std::min(D, inD); i++)
     ret.data[i] = this->data[i] + v.data[i];
@@ -204,7 +254,7 @@ vec<D, T> vec<D, T>::operator+(const vec<inD, inT> &v) const {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-vec<D, T> vec<D, T>::operator-(const vec<inD, inT> &v) const {
+constexpr vec<D, T> vec<D, T>::operator-(const vec<inD, inT> &v) const {
   vec<D, T> ret;
   for (uint8_t i = 0; i < std::min(D, inD); i++)
     ret.data[i] = this->data[i] - v.data[i];
@@ -213,7 +263,7 @@ vec<D, T> vec<D, T>::operator-(const vec<inD, inT> &v) const {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-vec<D, T> vec<D, T>::operator*(const vec<inD, inT> &v) const {
+constexpr vec<D, T> vec<D, T>::operator*(const vec<inD, inT> &v) const {
   vec<D, T> ret;
   for (uint8_t i = 0; i < std::min(D, inD); i++)
     ret.data[i] = this->data[i] * v.data[i];
@@ -222,7 +272,7 @@ vec<D, T> vec<D, T>::operator*(const vec<inD, inT> &v) const {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-vec<D, T> vec<D, T>::operator/(const vec<inD, inT> &v) const {
+constexpr vec<D, T> vec<D, T>::operator/(const vec<inD, inT> &v) const {
   vec<D, T> ret;
   for (uint8_t i = 0; i < std::min(D, inD); i++)
     ret.data[i] = this->data[i] / v.data[i];
@@ -231,7 +281,7 @@ vec<D, T> vec<D, T>::operator/(const vec<inD, inT> &v) const {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-vec<D, T> vec<D, T>::operator%(const vec<inD, inT> &v) const {
+constexpr vec<D, T> vec<D, T>::operator%(const vec<inD, inT> &v) const {
   vec<D, T> ret;
   for (uint8_t i = 0; i < std::min(D, inD); i++)
     ret.data[i] = this->data[i] % v.data[i];
@@ -239,7 +289,7 @@ vec<D, T> vec<D, T>::operator%(const vec<inD, inT> &v) const {
 }
 
 template <uint8_t D, typename T>
-vec<D, T> vec<D, T>::operator*(const T &v) const {
+constexpr vec<D, T> vec<D, T>::operator*(const T &v) const {
   vec<D, T> out;
   for (uint8_t i = 0; i < D; i++)
     out.data[i] = this->data[i] * v;
@@ -247,7 +297,7 @@ vec<D, T> vec<D, T>::operator*(const T &v) const {
 }
 
 template <uint8_t D, typename T>
-vec<D, T> vec<D, T>::operator/(const T &v) const {
+constexpr vec<D, T> vec<D, T>::operator/(const T &v) const {
   vec<D, T> out;
   for (uint8_t i = 0; i < D; i++)
     out.data[i] = this->data[i] / v;
@@ -255,7 +305,7 @@ vec<D, T> vec<D, T>::operator/(const T &v) const {
 }
 
 template <uint8_t D, typename T>
-vec<D, T> vec<D, T>::operator%(const T &v) const {
+constexpr vec<D, T> vec<D, T>::operator%(const T &v) const {
   vec<D, T> out;
   for (uint8_t i = 0; i < D; i++)
     out.data[i] = this->data[i] % v;
@@ -266,55 +316,59 @@ vec<D, T> vec<D, T>::operator%(const T &v) const {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-void vec<D, T>::operator=(const vec<inD, inT> &v) {
+constexpr void vec<D, T>::operator=(const vec<inD, inT> &v) {
   for (uint8_t i = 0; i < D; i++)
     this->data[i] = i < inD ? v.data[i] : 0;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-void vec<D, T>::operator+=(const vec<inD, inT> &v) {
+constexpr void vec<D, T>::operator+=(const vec<inD, inT> &v) {
   *this = *this + v;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-void vec<D, T>::operator-=(const vec<inD, inT> &v) {
+constexpr void vec<D, T>::operator-=(const vec<inD, inT> &v) {
   *this = *this - v;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-void vec<D, T>::operator*=(const vec<inD, inT> &v) {
+constexpr void vec<D, T>::operator*=(const vec<inD, inT> &v) {
   *this = *this * v;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-void vec<D, T>::operator/=(const vec<inD, inT> &v) {
+constexpr void vec<D, T>::operator/=(const vec<inD, inT> &v) {
   *this = *this / v;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-void vec<D, T>::operator%=(const vec<inD, inT> &v) {
+constexpr void vec<D, T>::operator%=(const vec<inD, inT> &v) {
   *this = *this % v;
 }
 
-template <uint8_t D, typename T> void vec<D, T>::operator=(const T &v) {
+template <uint8_t D, typename T>
+constexpr void vec<D, T>::operator=(const T &v) {
   for (uint8_t i = 0; i < D; i++)
     this->data[i] = v;
 }
 
-template <uint8_t D, typename T> void vec<D, T>::operator*=(const T &v) {
+template <uint8_t D, typename T>
+constexpr void vec<D, T>::operator*=(const T &v) {
   *this = *this * v;
 }
 
-template <uint8_t D, typename T> void vec<D, T>::operator/=(const T &v) {
+template <uint8_t D, typename T>
+constexpr void vec<D, T>::operator/=(const T &v) {
   *this = *this / v;
 }
 
-template <uint8_t D, typename T> void vec<D, T>::operator%=(const T &v) {
+template <uint8_t D, typename T>
+constexpr void vec<D, T>::operator%=(const T &v) {
   *this = *this % v;
 }
 
@@ -322,7 +376,7 @@ template <uint8_t D, typename T> void vec<D, T>::operator%=(const T &v) {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-bool vec<D, T>::operator==(const vec<inD, inT> &v) const {
+constexpr bool vec<D, T>::operator==(const vec<inD, inT> &v) const {
   for (uint8_t i = 0; i < D; i++)
     if (this->data[i] != v.data[i])
       return false;
@@ -331,63 +385,76 @@ bool vec<D, T>::operator==(const vec<inD, inT> &v) const {
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-bool vec<D, T>::operator!=(const vec<inD, inT> &v) const {
-  for (uint8_t i = 0; i < D; i++)
-    if (this->data[i] == v.data[i])
-      return false;
-  return true;
+constexpr bool vec<D, T>::operator!=(const vec<inD, inT> &v) const {
+  return !(*this == v);
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-bool vec<D, T>::operator>(const vec<inD, inT> &v) const {
+constexpr bool vec<D, T>::operator>(const vec<inD, inT> &v) const {
   return false;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-bool vec<D, T>::operator<(const vec<inD, inT> &v) const {
+constexpr bool vec<D, T>::operator<(const vec<inD, inT> &v) const {
   return false;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-bool vec<D, T>::operator>=(const vec<inD, inT> &v) const {
+constexpr bool vec<D, T>::operator>=(const vec<inD, inT> &v) const {
   return false;
 }
 
 template <uint8_t D, typename T>
 template <uint8_t inD, typename inT>
-bool vec<D, T>::operator<=(const vec<inD, inT> &v) const {
+constexpr bool vec<D, T>::operator<=(const vec<inD, inT> &v) const {
   return false;
 }
 
 // Other Operators
 
-template <uint8_t D, typename T> T vec<D, T>::operator[](uint8_t i) const {
+template <uint8_t D, typename T>
+constexpr T vec<D, T>::operator[](uint8_t i) const {
   return this->data[i % D];
 }
 
-template <uint8_t D, typename T> T &vec<D, T>::operator[](uint8_t i) {
+template <uint8_t D, typename T>
+constexpr T &vec<D, T>::operator[](uint8_t i) {
   return this->data[i % D];
 }
 
-template <uint8_t D, typename T> void vec<D, T>::operator++() { *this += 1.0f; }
+template <uint8_t D, typename T>
+constexpr void vec<D, T>::operator++() { *this += 1.0f; }
 
-template <uint8_t D, typename T> void vec<D, T>::operator--() { *this -= 1.0f; }
+template <uint8_t D, typename T>
+constexpr void vec<D, T>::operator--() { *this -= 1.0f; }
 
 // Functions (Instance Methods)
 
-template <uint8_t D, typename T> T vec<D, T>::length() const {
-  return sqrtf(dot(*this, *this));
+template <uint8_t D, typename T>
+template <typename P>
+T vec<D, T>::length() const {
+  T squared = dot<P>(*this, *this);
+
+  if constexpr (std::is_same_v<P, policy::fast>)
+    return squared > 0 ? squared * __vec::rsqrt(squared) : 0;
+  else
+    return static_cast<T>(std::sqrt(squared));
 }
 
-template <uint8_t D, typename T> vec<D, T> vec<D, T>::normalize() const {
-  return *this / this->length();
+template <uint8_t D, typename T>
+template <typename P>
+vec<D, T> vec<D, T>::normalize() const {
+  if constexpr (std::is_same_v<P, policy::fast>)
+    return *this * __vec::rsqrt(dot<P>(*this, *this));
+  else
+    return *this / this->length<P>();
 }
 
 template <uint8_t D, typename T>
-vec<D, T> vec<D, T>::clamp(vec<D, T> min, vec<D, T> max) const {
+constexpr vec<D, T> vec<D, T>::clamp(vec<D, T> min, vec<D, T> max) const {
   vec<D, T> out;
 
   for (uint8_t i = 0; i < D; i++) {
@@ -404,39 +471,60 @@ vec<D, T> vec<D, T>::clamp(vec<D, T> min, vec<D, T> max) const {
 
 // Functions (Static)
 
-template <uint8_t D, typename T> T vec<D, T>::distance(vec a, vec b) {
-  T out;
-
-  vec<D, T> dist = a - b;
-  for (uint8_t i = 0; i < D; i++)
-    out += dist[i] * dist[i];
-
-  return sqrt(out);
+template <uint8_t D, typename T>
+template <typename P>
+T vec<D, T>::distance(vec a, vec b) {
+  return (a - b).template length<P>();
 }
 
-template <uint8_t D, typename T> T vec<D, T>::dot(vec a, vec b) {
-  T out;
+template <uint8_t D, typename T>
+template <typename P>
+constexpr T vec<D, T>::dot(vec a, vec b) {
+  T out = 0;
 
-  for (uint8_t i = 0; i < D; i++)
-    out += a[i] * b[i];
+  for (uint8_t i = 0; i < D; i++) {
+    if constexpr (std::is_same_v<P, policy::fast>)
+      out = __vec::madd(a.data[i], b.data[i], out);
+    else
+      out += a.data[i] * b.data[i];
+  }
 
   return out;
 }
 
 template <uint8_t D, typename T>
-vec<D, T> vec<D, T>::lerp(vec<D, T> a, vec<D, T> b, T blend) {
+template <typename P>
+constexpr vec<D, T> vec<D, T>::lerp(vec<D, T> a, vec<D, T> b, T blend) {
   vec<D, T> out;
 
-  for (uint8_t i = 0; i < D; i++)
-    out[i] = a.data[i] + (b.data[i] - a.data[i]) * blend;
+  for (uint8_t i = 0; i < D; i++) {
+    if constexpr (std::is_same_v<P, policy::fast>)
+      out.data[i] = __vec::madd(b.data[i] - a.data[i], blend, a.data[i]);
+    else
+      out.data[i] = a.data[i] + (b.data[i] - a.data[i]) * blend;
+  }
 
   return out;
 }
 
 // Functions (Dimension-Specific)
 
-template <uint8_t D, typename T> vec<3> vec<D, T>::cross(vec<3> a, vec<3> b) {
-  return std::vector<T>({a.data[1] * b.data[2] - a.data[2] * b.data[1],
-                         a.data[2] * b.data[0] - a.data[0] * b.data[2],
-                         a.data[0] * b.data[1] - a.data[1] * b.data[0]});
-}
\ No newline at end of file
+template <uint8_t D, typename T>
+constexpr vec<3> vec<D, T>::cross(vec<3> a, vec<3> b) {
+  return vec<3>(a.data[1] * b.data[2] - a.data[2] * b.data[1],
+                a.data[2] * b.data[0] - a.data[0] * b.data[2],
+                a.data[0] * b.data[1] - a.data[1] * b.data[0]);
+}
+
+// Compile-Time Checks
+
+static_assert(vec<3>(1, 2, 3)[2] == 3, "vec construction is not constexpr");
+static_assert(vec<4>(2)[3] == 2, "vec broadcast is not constexpr");
+static_assert(vec<3>(vec<2>(1, 2))[2] == 0, "vec conversion is not constexpr");
+static_assert(vec<2>(1, 2) + vec<2>(3, 4) == vec<2>(4, 6),
+              "vec arithmetic is not constexpr");
+static_assert(vec<3>::dot(vec<3>(1, 2, 3), vec<3>(4, 5, 6)) == 32,
+              "vec::dot is not constexpr");
+static_assert(vec<3>::cross(vec<3>(1, 0, 0), vec<3>(0, 1, 0)) ==
+                  vec<3>(0, 0, 1),
+              "vec::cross is not constexpr");
\ No newline at end of file
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "simd.hpp"
+#include "vec.hpp"
+
+// Structure-of-Arrays Vector Container
+// (one 64-byte aligned stream per component, padded to whole SIMD lanes)
+template <uint8_t D = 3, typename T = float> struct vec_soa {
+  static_assert(D != 0, "Null-Vectors are not supported");
+
+  static constexpr size_t alignment = 64;
+
+  // Streams are padded to a multiple of this, so element-wise operations can
+  // run whole lanes without a scalar tail
+  static constexpr size_t padding =
+      alignment / sizeof(T) > 16 ? alignment / sizeof(T) : 16;
+
+  T *data[D] = {};
+  size_t count = 0;
+  size_t capacity = 0;
+
+  // Constructors & Destructor
+
+  vec_soa(size_t count = 0);
+  vec_soa(const vec_soa &v);
+  vec_soa(vec_soa &&v);
+
+  ~vec_soa();
+
+  // Assignment Operators
+
+  vec_soa &operator=(vec_soa v);
+
+  // Other Operators
+
+  vec<D, T> operator[](size_t i) const;
+
+  // Functions (Instance Methods)
+
+  size_t size() const;
+  void resize(size_t count);
+  void reserve(size_t capacity);
+
+  void set(size_t i, vec<D, T> v);
+  void push_back(vec<D, T> v);
+
+  vec<D, T> min() const;
+  vec<D, T> max() const;
+
+  // AoS Conversion (e.g. gather(vertices, n, &Vertex::position))
+
+  static vec_soa gather(const vec<D, T> *src, size_t count);
+  template <typename S>
+  static vec_soa gather(const S *src, size_t count, vec<D, T> S::*member);
+
+  void scatter(vec<D, T> *dst) const;
+  template <typename S> void scatter(S *dst, vec<D, T> S::*member) const;
+
+  // Bulk Operations (out may alias an input)
+
+  static void add(const vec_soa &a, const vec_soa &b, vec_soa &out);
+  static void scale(const vec_soa &a, T s, vec_soa &out);
+  static void dot(const vec_soa &a, const vec_soa &b, T *out);
+  template <typename P = policy::precise>
+  static void normalize(const vec_soa &a, vec_soa &out);
+  static void lerp(const vec_soa &a, const vec_soa &b, T blend,
+                   vec_soa &out);
+
+private:
+  // Elements including lane padding
+  size_t padded() const;
+
+  static constexpr bool packed = std::is_same_v<T, float>;
+};
+
+// Constructors & Destructor
+
+template <uint8_t D, typename T> vec_soa<D, T>::vec_soa(size_t count) {
+  resize(count);
+}
+
+template <uint8_t D, typename T>
+vec_soa<D, T>::vec_soa(const vec_soa &v) {
+  resize(v.count);
+  for (uint8_t c = 0; c < D; c++)
+    memcpy(data[c], v.data[c], v.count * sizeof(T));
+}
+
+template <uint8_t D, typename T> vec_soa<D, T>::vec_soa(vec_soa &&v) {
+  for (uint8_t c = 0; c < D; c++)
+    std::swap(data[c], v.data[c]);
+  std::swap(count, v.count);
+  std::swap(capacity, v.capacity);
+}
+
+template <uint8_t D, typename T> vec_soa<D, T>::~vec_soa() {
+  for (uint8_t c = 0; c < D; c++)
+    free(data[c]);
+}
+
+// Assignment Operators
+
+template <uint8_t D, typename T>
+vec_soa<D, T> &vec_soa<D, T>::operator=(vec_soa v) {
+  for (uint8_t c = 0; c < D; c++)
+    std::swap(data[c], v.data[c]);
+  std::swap(count, v.count);
+  std::swap(capacity, v.capacity);
+  return *this;
+}
+
+// Other Operators
+
+template <uint8_t D, typename T>
+vec<D, T> vec_soa<D, T>::operator[](size_t i) const {
+  vec<D, T> out;
+  for (uint8_t c = 0; c < D; c++)
+    out.data[c] = data[c][i];
+  return out;
+}
+
+// Functions (Instance Methods)
+
+template <uint8_t D, typename T> size_t vec_soa<D, T>::size() const {
+  return count;
+}
+
+template <uint8_t D, typename T> void vec_soa<D, T>::resize(size_t count) {
+  reserve(count);
+
+  // Capacity may be reused after shrinking, so grown elements start at zero
+  // rather than whatever was (or whole-lane operations wrote) there before
+  if (count > this->count)
+    for (uint8_t c = 0; c < D; c++)
+      memset(data[c] + this->count, 0, (count - this->count) * sizeof(T));
+
+  this->count = count;
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::reserve(size_t capacity) {
+  capacity = (capacity + padding - 1) / padding * padding;
+  if (capacity <= this->capacity)
+    return;
+
+  for (uint8_t c = 0; c < D; c++) {
+    T *stream =
+        static_cast<T *>(aligned_alloc(alignment, capacity * sizeof(T)));
+    if (!stream)
+      throw std::bad_alloc();
+
+    // Zero the padding too, so whole-lane operations never see garbage
+    memset(stream, 0, capacity * sizeof(T));
+    if (data[c])
+      memcpy(stream, data[c], count * sizeof(T));
+
+    free(data[c]);
+    data[c] = stream;
+  }
+
+  this->capacity = capacity;
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::set(size_t i, vec<D, T> v) {
+  for (uint8_t c = 0; c < D; c++)
+    data[c][i] = v.data[c];
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::push_back(vec<D, T> v) {
+  if (count == capacity)
+    reserve(capacity ? capacity * 2 : padding);
+  set(count++, v);
+}
+
+template <uint8_t D, typename T> vec<D, T> vec_soa<D, T>::min() const {
+  vec<D, T> out(std::numeric_limits<T>::max());
+
+  for (uint8_t c = 0; c < D; c++) {
+    size_t i = 0;
+
+    if constexpr (packed) {
+      if (count >= __simd::width) {
+        __simd::f32 m = __simd::loada(data[c]);
+        for (i = __simd::width; i + __simd::width <= count;
+             i += __simd::width)
+          m = __simd::min(m, __simd::loada(data[c] + i));
+        out.data[c] = __simd::hmin(m);
+      }
+    }
+
+    for (; i < count; i++)
+      out.data[c] = data[c][i] < out.data[c] ? data[c][i] : out.data[c];
+  }
+
+  return out;
+}
+
+template <uint8_t D, typename T> vec<D, T> vec_soa<D, T>::max() const {
+  vec<D, T> out(std::numeric_limits<T>::lowest());
+
+  for (uint8_t c = 0; c < D; c++) {
+    size_t i = 0;
+
+    if constexpr (packed) {
+      if (count >= __simd::width) {
+        __simd::f32 m = __simd::loada(data[c]);
+        for (i = __simd::width; i + __simd::width <= count;
+             i += __simd::width)
+          m = __simd::max(m, __simd::loada(data[c] + i));
+        out.data[c] = __simd::hmax(m);
+      }
+    }
+
+    for (; i < count; i++)
+      out.data[c] = data[c][i] > out.data[c] ? data[c][i] : out.data[c];
+  }
+
+  return out;
+}
+
+template <uint8_t D, typename T> size_t vec_soa<D, T>::padded() const {
+  if constexpr (packed)
+    return (count + __simd::width - 1) / __simd::width * __simd::width;
+  else
+    return count;
+}
+
+// AoS Conversion
+
+template <uint8_t D, typename T>
+vec_soa<D, T> vec_soa<D, T>::gather(const vec<D, T> *src, size_t count) {
+  vec_soa<D, T> out(count);
+  for (size_t i = 0; i < count; i++)
+    out.set(i, src[i]);
+  return out;
+}
+
+template <uint8_t D, typename T>
+template <typename S>
+vec_soa<D, T> vec_soa<D, T>::gather(const S *src, size_t count,
+                                    vec<D, T> S::*member) {
+  vec_soa<D, T> out(count);
+  for (size_t i = 0; i < count; i++)
+    out.set(i, src[i].*member);
+  return out;
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::scatter(vec<D, T> *dst) const {
+  for (size_t i = 0; i < count; i++)
+    dst[i] = (*this)[i];
+}
+
+template <uint8_t D, typename T>
+template <typename S>
+void vec_soa<D, T>::scatter(S *dst, vec<D, T> S::*member) const {
+  for (size_t i = 0; i < count; i++)
+    dst[i].*member = (*this)[i];
+}
+
+// Bulk Operations
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::add(const vec_soa &a, const vec_soa &b, vec_soa &out) {
+  out.resize(a.count < b.count ? a.count : b.count);
+
+  for (uint8_t c = 0; c < D; c++) {
+    const T *pa = a.data[c], *pb = b.data[c];
+    T *po = out.data[c];
+
+    if constexpr (packed) {
+      for (size_t i = 0; i < out.padded(); i += __simd::width)
+        __simd::storea(po + i, __simd::add(__simd::loada(pa + i),
+                                           __simd::loada(pb + i)));
+    } else {
+      for (size_t i = 0; i < out.count; i++)
+        po[i] = pa[i] + pb[i];
+    }
+  }
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::scale(const vec_soa &a, T s, vec_soa &out) {
+  out.resize(a.count);
+
+  for (uint8_t c = 0; c < D; c++) {
+    const T *pa = a.data[c];
+    T *po = out.data[c];
+
+    if constexpr (packed) {
+      const __simd::f32 vs = __simd::set(s);
+      for (size_t i = 0; i < out.padded(); i += __simd::width)
+        __simd::storea(po + i, __simd::mul(__simd::loada(pa + i), vs));
+    } else {
+      for (size_t i = 0; i < out.count; i++)
+        po[i] = pa[i] * s;
+    }
+  }
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::dot(const vec_soa &a, const vec_soa &b, T *out) {
+  size_t count = a.count < b.count ? a.count : b.count;
+  size_t i = 0;
+
+  // out is caller memory without padding, so finish with a scalar tail
+  if constexpr (packed) {
+    for (; i + __simd::width <= count; i += __simd::width) {
+      __simd::f32 sum = __simd::set(0.0f);
+      for (uint8_t c = 0; c < D; c++)
+        sum = __simd::madd(__simd::loada(a.data[c] + i),
+                           __simd::loada(b.data[c] + i), sum);
+
+      memcpy(out + i, &sum, sizeof(sum));
+    }
+  }
+
+  for (; i < count; i++) {
+    out[i] = 0;
+    for (uint8_t c = 0; c < D; c++)
+      out[i] += a.data[c][i] * b.data[c][i];
+  }
+}
+
+template <uint8_t D, typename T>
+template <typename P>
+void vec_soa<D, T>::normalize(const vec_soa &a, vec_soa &out) {
+  out.resize(a.count);
+
+  if constexpr (packed) {
+    for (size_t i = 0; i < out.padded(); i += __simd::width) {
+      __simd::f32 squared = __simd::set(0.0f);
+      for (uint8_t c = 0; c < D; c++) {
+        __simd::f32 v = __simd::loada(a.data[c] + i);
+        squared = __simd::madd(v, v, squared);
+      }
+
+      __simd::f32 scale;
+      if constexpr (std::is_same_v<P, policy::fast>)
+        scale = __simd::rsqrt(squared);
+      else
+        scale = __simd::div(__simd::set(1.0f), __simd::sqrt(squared));
+
+      for (uint8_t c = 0; c < D; c++)
+        __simd::storea(out.data[c] + i,
+                       __simd::mul(__simd::loada(a.data[c] + i), scale));
+    }
+
+    // Padding lanes came out as 0 * rsqrt(0) = NaN, keep them clean
+    for (uint8_t c = 0; c < D; c++)
+      memset(out.data[c] + out.count, 0,
+             (out.padded() - out.count) * sizeof(T));
+  } else {
+    for (size_t i = 0; i < out.count; i++)
+      out.set(i, a[i].template normalize<P>());
+  }
+}
+
+template <uint8_t D, typename T>
+void vec_soa<D, T>::lerp(const vec_soa &a, const vec_soa &b, T blend,
+                         vec_soa &out) {
+  out.resize(a.count < b.count ? a.count : b.count);
+
+  for (uint8_t c = 0; c < D; c++) {
+    const T *pa = a.data[c], *pb = b.data[c];
+    T *po = out.data[c];
+
+    if constexpr (packed) {
+      const __simd::f32 t = __simd::set(blend);
+      for (size_t i = 0; i < out.padded(); i += __simd::width) {
+        __simd::f32 va = __simd::loada(pa + i);
+        __simd::storea(po + i, __simd::madd(__simd::sub(__simd::loada(pb + i),
+                                                        va),
+                                            t, va));
+      }
+    } else {
+      for (size_t i = 0; i < out.count; i++)
+        po[i] = pa[i] + (pb[i] - pa[i]) * blend;
+    }
+  }
+}
@@ -48,6 +48,9 @@ struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
 
+  // Transfer-only family (DMA engine), if the device has one
+  std::optional<uint32_t> transferFamily;
+
   bool isComplete() {
     return graphicsFamily.has_value() && presentFamily.has_value();
   }
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <types.hpp>
+
+#include "image.hpp"
+
+// Texture Atlas (many small RGBA8 images packed into the layers of one 2D
+// array texture, so they share one image, view & descriptor)
+//
+// Atlas: images are shelf-packed into layers, each surrounded by a gutter of
+// its edge texels & placed on a grid of the gutter size, so every level down
+// to a gutter of one texel only ever filters texels of the same image.
+//
+// Array: every image gets a layer of its own (at its origin, padded with its
+// edge texels up to the largest image) & the layers keep their full chain.
+struct TextureAtlas {
+  enum class Mode { Atlas, Array };
+
+  // Where an image ended up (texels of level 0)
+  struct Region {
+    uint32_t layer;
+    uint32_t x, y;
+    uint32_t width, height;
+
+    // Image UVs to layer UVs
+    vec<2> offset, scale;
+
+    // (UVs outside [0, 1] are clamped, nothing wraps inside a layer)
+    vec<2> remap(vec<2> uv) const;
+  };
+
+  // Layer extent, shared by every layer
+  uint32_t width = 0, height = 0;
+  uint32_t mipLevels = 1;
+
+  // One chain per layer
+  std::vector<Image> layers;
+
+  // One per packed image, in order
+  std::vector<Region> regions;
+
+  // Pack images (srgb: whether levels are averaged in sRGB or linear space,
+  // matching the format they're uploaded as; size: largest layer side,
+  // padding: gutter texels, a power of two setting how many levels stay
+  // apart)
+  static TextureAtlas pack(const std::vector<Image> &images, bool srgb,
+                           Mode mode = Mode::Atlas, uint32_t size = 2048,
+                           uint32_t padding = 8);
+
+  // Point texture coordinates at an image's region (e.g. right after the
+  // model using it is loaded)
+  static void remap(std::vector<Vertex> &vertices, const Region &region);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "image.hpp"
+
+// Block Compression Formats (4x4 texel blocks)
+enum class BlockFormat {
+  BC1, // RGB, 8 bytes (fast, 8:1 against RGBA8)
+  BC3, // RGBA, 16 bytes (BC1 colour & BC4 alpha)
+  BC5, // RG, 16 bytes (two BC4 channels, e.g. tangent-space normals)
+  BC7, // RGBA, 16 bytes (best colour quality)
+};
+
+// Block-Compressed Image & Mip Chain
+// (levels are tightly packed one after another, level 0 first)
+struct CompressedImage {
+  BlockFormat format = BlockFormat::BC7;
+
+  uint32_t width = 0, height = 0;
+  uint32_t mipLevels = 1;
+
+  std::vector<uint8_t> data;
+
+  // Encode every level of an image (on all hardware threads)
+  static CompressedImage encode(const Image &image, BlockFormat format);
+
+  // Bytes per 4x4 block
+  static uint32_t blockSize(BlockFormat format);
+
+  // Level extent (in texels) & location in data
+  uint32_t levelWidth(uint32_t level) const;
+  uint32_t levelHeight(uint32_t level) const;
+  size_t levelOffset(uint32_t level) const;
+  size_t levelSize(uint32_t level) const;
+
+  // Single Blocks (16 RGBA8 texels, row by row)
+  static void encodeBC1(const uint8_t *texels, uint8_t *block);
+  static void encodeBC3(const uint8_t *texels, uint8_t *block);
+  static void encodeBC5(const uint8_t *texels, uint8_t *block);
+  static void encodeBC7(const uint8_t *texels, uint8_t *block);
+};
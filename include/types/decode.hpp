@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Image Decoding (PNG, JPEG, HDR, ... through stb_image)
+//
+// Images keep as few channels as they have: grey images decode to R8, grey &
+// alpha to RG8, HDR images to RGBA16F & everything else to RGBA8.
+//
+// Files are probed first, so every image can be decoded straight into memory
+// reserved for it up front (e.g. a mapped staging region), and batches are
+// decoded on every hardware thread.
+struct ImageDecoder {
+  enum class Format { R8, RG8, RGBA8, RGBA16F };
+
+  struct Job {
+    std::string path;
+
+    // Decode to RGBA8 whatever the file has (e.g. for CPU-built mip chains)
+    bool expand = false;
+
+    // Filled in by probe()
+    uint32_t width = 0, height = 0;
+    Format format = Format::RGBA8;
+    bool valid = false;
+
+    // Where the pixels go (size() bytes)
+    void *dst = nullptr;
+    bool decoded = false;
+
+    size_t size() const {
+      return size_t(width) * height * bytesPerPixel(format);
+    }
+  };
+
+  static size_t bytesPerPixel(Format format);
+
+  // Read the extent from the file header only
+  static bool probe(Job &job);
+
+  // Decode into job.dst (the image must still match its probed extent)
+  static bool decode(Job &job);
+
+  // Probe / decode many images at once (jobs without a dst are skipped)
+  static void probe(std::vector<Job> &jobs,
+                    size_t threads = std::thread::hardware_concurrency());
+  static void decode(std::vector<Job> &jobs,
+                     size_t threads = std::thread::hardware_concurrency());
+};
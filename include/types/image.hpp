@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// RGBA8 Image & Mip Chain
+// (levels are tightly packed one after another, level 0 first)
+struct Image {
+  uint32_t width = 0, height = 0;
+  uint32_t mipLevels = 1;
+
+  std::vector<uint8_t> pixels;
+
+  Image() = default;
+  Image(uint32_t width, uint32_t height, const void *rgba);
+
+  // Levels in a full chain (down to 1x1)
+  static uint32_t fullMipLevels(uint32_t width, uint32_t height);
+
+  // Level extent & location in pixels
+  uint32_t levelWidth(uint32_t level) const;
+  uint32_t levelHeight(uint32_t level) const;
+  size_t levelOffset(uint32_t level) const;
+  size_t levelSize(uint32_t level) const;
+
+  // Build the full chain on the CPU
+  // (srgb: colour is averaged in linear space, alpha always is linear)
+  void generateMips(bool srgb = true);
+
+  // 2x2 Box Filter (one level into the next, SIMD lanes where available)
+  static void downsample(const uint8_t *src, uint32_t width, uint32_t height,
+                         uint8_t *dst, bool srgb);
+};
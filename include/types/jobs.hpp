@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Parallel Loop
+// (runs fn(begin, end) over chunks of [0, count) on every hardware thread,
+// chunks are handed out dynamically so uneven work stays balanced)
+template <typename F>
+void parallelFor(size_t count, F &&fn, size_t grain = 1,
+                 size_t threads = std::thread::hardware_concurrency()) {
+  grain = std::max<size_t>(grain, 1);
+  threads = std::clamp<size_t>(threads, 1, (count + grain - 1) / grain);
+
+  if (threads <= 1) {
+    if (count)
+      fn(size_t(0), count);
+    return;
+  }
+
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t begin; (begin = next.fetch_add(grain)) < count;)
+      fn(begin, std::min(begin + grain, count));
+  };
+
+  // The calling thread works too
+  std::vector<std::thread> pool;
+  for (size_t i = 1; i < threads; i++)
+    pool.emplace_back(worker);
+
+  worker();
+
+  for (std::thread &thread : pool)
+    thread.join();
+}
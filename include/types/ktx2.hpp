@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "bc.hpp"
+#include "image.hpp"
+
+// KTX2 Texture Container
+// (2D textures only; the file is memory-mapped & levels without
+// supercompression are used in place, so loading decodes no pixels)
+class Ktx2Texture {
+public:
+  enum Supercompression : uint32_t {
+    None = 0,
+    BasisLZ = 1, // not supported (needs transcoding)
+    Zstandard = 2,
+    Zlib = 3,
+  };
+
+  struct Level {
+    const uint8_t *data;
+    size_t size;
+
+    uint32_t width, height;
+  };
+
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  uint32_t width = 0, height = 0;
+
+  Supercompression supercompression = None;
+
+  // Level 0 first
+  std::vector<Level> levels;
+
+  Ktx2Texture(const char *path);
+  ~Ktx2Texture();
+
+  Ktx2Texture(const Ktx2Texture &) = delete;
+  Ktx2Texture &operator=(const Ktx2Texture &) = delete;
+
+  // Bytes of all levels (as uploaded)
+  size_t size() const;
+
+  // Whether a supercompression scheme was built in
+  static bool supports(Supercompression scheme);
+
+  // Write a container (srgb: colour is stored in sRGB, BC5 never is)
+  static void write(const char *path, const Image &image, bool srgb,
+                    Supercompression scheme = None);
+  static void write(const char *path, const CompressedImage &image, bool srgb,
+                    Supercompression scheme = None);
+
+private:
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+
+  // Inflated levels (supercompressed files only)
+  std::vector<std::vector<uint8_t>> inflated;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "image.hpp"
+
+// Tiled Texture (.vtex, the source of virtual textures)
+//
+// Every level of the mip chain is cut into square tiles with a border of
+// neighbouring texels (so filtering inside a tile never reads its
+// neighbours), stored uncompressed after one another: level by level, row
+// by row. The file is memory-mapped & tiles are read in place.
+//
+// Extents are powers of two & levels stop once the shorter side is a single
+// tile, so level L has (width >> L) / tileSize by (height >> L) / tileSize
+// tiles.
+class TiledTexture {
+public:
+  struct Header {
+    uint32_t magic; // "VTEX"
+    uint32_t version;
+
+    uint32_t format; // VkFormat (RGBA8 or BC7, sRGB or linear)
+    uint32_t width, height;
+
+    uint32_t tileSize; // texels per side, without the border
+    uint32_t border;   // texels around each tile
+    uint32_t levels;
+
+    uint64_t tileBytes;  // bytes per stored tile
+    uint64_t dataOffset; // first tile (page aligned)
+  };
+
+  Header header;
+
+  TiledTexture(const char *path);
+  ~TiledTexture();
+
+  TiledTexture(const TiledTexture &) = delete;
+  TiledTexture &operator=(const TiledTexture &) = delete;
+
+  VkFormat format() const;
+
+  // Texels per side of a stored tile (with the border)
+  uint32_t storedSize() const;
+
+  // Tiles per row / column of a level & index of its first tile
+  uint32_t pagesX(uint32_t level) const;
+  uint32_t pagesY(uint32_t level) const;
+  uint32_t firstTile(uint32_t level) const;
+  uint32_t tileCount() const;
+
+  // Stored tile (tileBytes, row by row; BC7 in rows of blocks)
+  const uint8_t *tile(uint32_t index) const;
+
+  // Cut a tiled file out of RGBA8 pixels (read in place, the chain below
+  // is built level by level & written one row of tiles at a time)
+  // (bc7: block-compress every tile, the border must be a multiple of 4;
+  // wrapX: the border wraps around horizontally, e.g. equirectangular maps)
+  static void write(const char *path, const uint8_t *rgba, uint32_t width,
+                    uint32_t height, bool srgb, bool bc7,
+                    uint32_t tileSize = 128, uint32_t border = 4,
+                    bool wrapX = false);
+
+private:
+  void *mapping = nullptr;
+  size_t mappingSize = 0;
+};
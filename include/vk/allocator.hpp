@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct MemoryBlock;
+
+// Memory Usage Classes (decide which memory type a resource lands in)
+enum class MemoryUsage {
+  Static,    // device-local, written once through staging (geometry, textures)
+  Dynamic,   // rewritten by the host every frame (device-local & mapped with
+             // resizable BAR, otherwise device-local & written through staging)
+  Staging,   // host-visible source of transfers (kept out of the BAR heap)
+  Readback,  // host-visible (preferably cached) destination of transfers
+  Transient, // attachments that never leave the GPU (lazily allocated when
+             // available, always dedicated so they can be aliased)
+};
+
+// Sub-Allocated Device Memory
+struct Allocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size = 0;
+
+  // Persistently mapped pointer (host-accessed usages only, so a Dynamic
+  // allocation without it must be written through staging)
+  void *mapped = nullptr;
+
+  uint32_t memoryType = 0;
+
+  // Owning block & buddy level (nullptr for dedicated allocations)
+  MemoryBlock *block = nullptr;
+  uint32_t level = 0;
+};
+
+// Device Memory Allocator
+// (per memory type pools of large blocks, split with a buddy allocator)
+class Allocator {
+public:
+  struct Stats {
+    uint32_t blocks = 0;      // vkAllocateMemory calls backing pools
+    uint32_t dedicated = 0;   // vkAllocateMemory calls for large resources
+    uint32_t allocations = 0; // live sub-allocations (incl. dedicated)
+
+    VkDeviceSize reserved = 0;  // bytes of device memory allocated
+    VkDeviceSize used = 0;      // bytes handed out (incl. buddy rounding)
+    VkDeviceSize requested = 0; // bytes asked for
+
+    uint32_t evictions = 0; // resources evicted to stay within budget
+    VkDeviceSize evicted = 0;
+
+    bool memoryBudget = false; // budget from VK_EXT_memory_budget
+    bool rebar = false;        // Dynamic memory (uniforms) written in place
+  };
+
+  // Per-Heap Accounting
+  // (budget & usage come from VK_EXT_memory_budget when enabled, otherwise
+  // the budget is 80% of the heap & usage is what this allocator reserved)
+  struct HeapBudget {
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+
+    VkDeviceSize reserved = 0; // device memory allocated by this allocator
+    VkDeviceSize used = 0;     // of which handed out
+    uint32_t allocations = 0;
+  };
+
+  // Smallest buddy node (keeps free lists short for tiny buffers)
+  static constexpr VkDeviceSize minNodeSize = 256;
+
+  // (memoryBudget: VK_EXT_memory_budget is enabled on a Vulkan 1.1 device)
+  Allocator(VkPhysicalDevice physicalDevice, VkDevice device,
+            bool memoryBudget = false);
+  ~Allocator();
+
+  // Find Memory Type
+  // (first type with all properties / best scoring type for a usage)
+  uint32_t findMemoryType(uint32_t typeFilter,
+                          VkMemoryPropertyFlags properties);
+  uint32_t findMemoryType(uint32_t typeFilter, MemoryUsage usage);
+
+  // Allocate / Free Memory
+  // (linear: buffers & linear-tiled images, kept apart from optimal images
+  // to honour bufferImageGranularity)
+  Allocation allocate(const VkMemoryRequirements &requirements,
+                      MemoryUsage usage, bool linear);
+  void free(Allocation &allocation);
+
+  // Create & Bind Resources
+  void createBuffer(const VkBufferCreateInfo &bufferInfo, MemoryUsage usage,
+                    VkBuffer &buffer, Allocation &allocation);
+  void createImage(const VkImageCreateInfo &imageInfo, MemoryUsage usage,
+                   VkImage &image, Allocation &allocation);
+
+  void destroyBuffer(VkBuffer buffer, Allocation &allocation);
+  void destroyImage(VkImage image, Allocation &allocation);
+
+  Stats getStats();
+  std::vector<HeapBudget> getBudget();
+
+  // Highest usage / budget ratio of any heap (alert when close to 1)
+  float pressure();
+
+  // Property flags of a memory type
+  VkMemoryPropertyFlags memoryProperties(uint32_t memoryType) const;
+
+  // Whether Dynamic memory is host-writable device-local memory
+  // (resizable BAR or unified memory; VULKAN_BASE_NO_REBAR=1 disables it)
+  bool rebar() const;
+
+  // Evictable Resources (e.g. textures the TextureManager keeps cached)
+  // (when a heap would go over budget, the least recently used ones the GPU
+  // is done with are evicted first; the callback must free the allocation
+  // & forget the resource, it is removed from the list before being called)
+  uint64_t addEvictable(const Allocation &allocation,
+                        std::function<void()> evict);
+  void removeEvictable(uint64_t handle);
+
+  // Mark an evictable resource as used by the current frame
+  void touch(uint64_t handle);
+
+  // Start a frame (completed: last frame the GPU has finished)
+  // (also refreshes the budget from the driver)
+  void beginFrame(uint64_t frame, uint64_t completed);
+
+private:
+  struct Evictable {
+    uint32_t heap;
+    VkDeviceSize size;
+    uint64_t lastUse;
+    std::function<void()> evict;
+  };
+
+  VkPhysicalDevice physicalDevice;
+  VkDevice device;
+
+  bool memoryBudget;
+
+  VkPhysicalDeviceMemoryProperties memProperties;
+  VkDeviceSize bufferImageGranularity;
+
+  bool hasRebar = false;
+
+  // Pools (per memory type, linear & optimal)
+  std::vector<MemoryBlock *> pools[VK_MAX_MEMORY_TYPES][2];
+
+  Stats stats;
+
+  std::vector<HeapBudget> heaps;
+  VkDeviceSize reservedAtQuery[VK_MAX_MEMORY_HEAPS] = {};
+
+  std::unordered_map<uint64_t, Evictable> evictables;
+  uint64_t nextEvictable = 1;
+
+  uint64_t frame = 1;
+  uint64_t completedFrame = 0;
+
+  std::mutex mutex;
+
+private:
+  // Preferred block size for a memory type (64 MB, 256 MB on large heaps)
+  VkDeviceSize blockSize(uint32_t memoryType);
+
+  VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType,
+                                void **mapped);
+  void freeMemory(VkDeviceMemory memory, VkDeviceSize size,
+                  uint32_t memoryType);
+
+  Allocation allocateDedicated(VkDeviceSize size, uint32_t memoryType);
+
+  // Sub-allocate or grow the pool (fails rather than going over budget,
+  // unless overBudget is set)
+  bool tryAllocate(VkDeviceSize size, VkDeviceSize nodeSize,
+                   uint32_t memoryType, bool linear, bool dedicated,
+                   bool overBudget, Allocation &out);
+
+  // Estimated heap usage & whether size more bytes stay within budget
+  VkDeviceSize heapUsage(uint32_t heap) const;
+  bool fitsBudget(uint32_t heap, VkDeviceSize size) const;
+
+  // Evict the least recently used resource of a heap (false if none)
+  bool evict(uint32_t heap);
+
+  // Refresh budgets & driver usage
+  void queryBudget();
+};
+
+// Block of Device Memory (split into power-of-two buddy nodes)
+struct MemoryBlock {
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+  char *mapped;
+
+  // Free node offsets per level (level 0 is the whole block)
+  std::vector<std::set<VkDeviceSize>> free = {};
+
+  VkDeviceSize used = 0;
+
+  // Allocate a node (returns false if the block is too fragmented)
+  bool allocate(uint32_t level, VkDeviceSize &offset);
+  void release(uint32_t level, VkDeviceSize offset);
+
+  uint32_t levelOf(VkDeviceSize nodeSize) const;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Deferred Destruction
+// (resources are destroyed once the last frame using them has finished, so
+// replacing them at runtime never waits for the device to go idle)
+class DeletionQueue {
+public:
+  ~DeletionQueue();
+
+  // Destroy once frame has finished on the GPU
+  // (frames are expected in increasing order)
+  void push(uint64_t frame, std::function<void()> destroy);
+
+  // Destroy everything queued for frames up to completed
+  void collect(uint64_t completed);
+
+  // Destroy everything (the device must be idle)
+  void flush();
+
+  size_t pending();
+
+private:
+  struct Entry {
+    uint64_t frame;
+    std::function<void()> destroy;
+  };
+
+  std::deque<Entry> entries;
+
+  std::mutex mutex;
+};
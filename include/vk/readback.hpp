@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "allocator.hpp"
+
+// Asynchronous GPU Readback
+// (copies are recorded into a frame's command buffer & land in pooled
+// host-visible buffers, results are handed out once that frame's fence has
+// passed, so nothing waits for the queue)
+class ReadbackQueue {
+public:
+  // Receives the copied bytes (only valid during the call)
+  using Callback = std::function<void(const void *data, VkDeviceSize size)>;
+
+  // Callback fulfilling a promise with a copy of the bytes
+  static Callback fulfil(std::promise<std::vector<char>> promise);
+
+  ReadbackQueue(VkDevice device, Allocator *allocator);
+  ~ReadbackQueue();
+
+  // Copy a buffer region, for the frame being recorded
+  void readBuffer(VkCommandBuffer commandBuffer, uint64_t frame,
+                  VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+                  Callback done);
+  std::future<std::vector<char>> readBuffer(VkCommandBuffer commandBuffer,
+                                            uint64_t frame, VkBuffer buffer,
+                                            VkDeviceSize offset,
+                                            VkDeviceSize size);
+
+  // Copy the first mip level of a 2D image, tightly packed
+  // (the image is used in layout & is left in it)
+  void readImage(VkCommandBuffer commandBuffer, uint64_t frame, VkImage image,
+                 VkImageLayout layout, VkExtent2D extent, uint32_t texelSize,
+                 Callback done);
+  std::future<std::vector<char>>
+  readImage(VkCommandBuffer commandBuffer, uint64_t frame, VkImage image,
+            VkImageLayout layout, VkExtent2D extent, uint32_t texelSize);
+
+  // Hand out the results of frames up to completed
+  void collect(uint64_t completed);
+
+  // Hand out everything (the device must be idle)
+  void flush();
+
+  size_t pending();
+
+private:
+  struct Buffer {
+    VkBuffer buffer;
+    Allocation memory;
+    VkDeviceSize size;
+  };
+
+  struct Request {
+    uint64_t frame;
+    Buffer buffer;
+    VkDeviceSize size;
+    Callback done;
+  };
+
+  VkDevice device;
+  Allocator *allocator;
+
+  // Buffers free for reuse & requests waiting on their frame
+  std::vector<Buffer> pool;
+  std::deque<Request> requests;
+
+  std::mutex mutex;
+
+private:
+  // Smallest pooled buffer that fits (a new one if none does)
+  Buffer acquire(VkDeviceSize size);
+
+  // Make the copy visible to the host & queue the request
+  void finish(VkCommandBuffer commandBuffer, uint64_t frame,
+              const Buffer &buffer, VkDeviceSize size, Callback done);
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+// Texture Filtering Profiles
+enum class SamplerProfile {
+  Performance, // bilinear, nearest mip, no anisotropy
+  Balanced,    // trilinear, 4x anisotropy
+  Quality      // trilinear, 16x anisotropy (or the device's maximum)
+};
+
+// Sampler Cache
+// (one sampler per distinct description, shared by every texture using it &
+// destroyed along with the cache; devices are limited to a few thousand
+// samplers, maxSamplerAllocationCount)
+//
+// Anisotropy is clamped to what the device supports & left off on devices
+// without samplerAnisotropy, so any description can be asked for.
+class SamplerCache {
+public:
+  struct Description {
+    VkFilter magFilter = VK_FILTER_LINEAR;
+    VkFilter minFilter = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+
+    VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+    float mipLodBias = 0.0f;
+    float maxAnisotropy = 1.0f; // 1 is off
+
+    VkBool32 compareEnable = VK_FALSE;
+    VkCompareOp compareOp = VK_COMPARE_OP_ALWAYS;
+
+    float minLod = 0.0f;
+    float maxLod = VK_LOD_CLAMP_NONE;
+
+    VkBorderColor borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    VkBool32 unnormalizedCoordinates = VK_FALSE;
+
+    bool operator==(const Description &other) const;
+  };
+
+  SamplerCache(VkPhysicalDevice physicalDevice, VkDevice device,
+               bool anisotropy);
+  ~SamplerCache();
+
+  // Description of a profile (sampling mip levels up to maxLod)
+  static Description profile(SamplerProfile profile,
+                             float maxLod = VK_LOD_CLAMP_NONE);
+
+  // The sampler for a description (created on first use)
+  VkSampler get(Description description);
+  VkSampler get(SamplerProfile profile, float maxLod = VK_LOD_CLAMP_NONE);
+
+  // Samplers created so far
+  size_t size();
+
+  // Highest anisotropy samplers get (1 without samplerAnisotropy)
+  float maxAnisotropy() const;
+
+private:
+  struct Hash {
+    size_t operator()(const Description &description) const;
+  };
+
+  VkDevice device;
+
+  float anisotropyLimit;
+
+  std::unordered_map<Description, VkSampler, Hash> samplers;
+
+  std::mutex mutex;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "allocator.hpp"
+
+// Persistently Mapped Staging Ring
+// (regions are reclaimed once the submission reading them has finished)
+class StagingRing {
+public:
+  struct Region {
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void *mapped;
+  };
+
+  StagingRing(VkDevice device, Allocator *allocator,
+              VkDeviceSize capacity = 64 * 1024 * 1024);
+  ~StagingRing();
+
+  // Reserve a region for the next submission
+  // (waits for older submissions if the ring is full)
+  Region allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+
+  // Copy data into a new region
+  Region push(const void *data, VkDeviceSize size,
+              VkDeviceSize alignment = 16);
+
+  // Submit work reading the regions allocated since the last submit
+  // (returns the serial of the submission)
+  uint64_t submit(VkQueue queue, const VkSubmitInfo &submitInfo);
+
+  // Wait for a submission (and all submissions before it)
+  void wait(uint64_t serial);
+
+  // Serial of the last submitted / finished submission
+  uint64_t submissions() const;
+  uint64_t completed();
+
+  // Largest region the ring can hold
+  VkDeviceSize size() const;
+
+  VkBuffer buffer;
+
+private:
+  struct Submission {
+    uint64_t serial;
+    VkFence fence;
+    uint64_t end;
+  };
+
+  VkDevice device;
+  Allocator *allocator;
+
+  Allocation memory;
+  VkDeviceSize capacity;
+
+  // Ring offsets (grow monotonically, wrap modulo capacity)
+  uint64_t head = 0;
+  uint64_t tail = 0;
+
+  uint64_t serial = 0;
+  uint64_t done = 0;
+
+  std::deque<Submission> inFlight;
+  std::vector<VkFence> fences;
+
+private:
+  // Reclaim finished submissions (waiting for the oldest one if block)
+  void retire(bool block);
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <types/ktx2.hpp>
+
+#include "allocator.hpp"
+#include "deletion.hpp"
+
+// Texture Streaming
+// (textures start out with only their smallest levels & are refined one
+// level at a time, most under-resolved first, within a per-frame byte
+// budget)
+//
+// Priorities come from the screen-space size each texture was drawn at in
+// the previous frame. Levels are copied row by row from per-frame slices
+// recorded in the frame's command buffer, so large levels are spread over
+// several frames. Once a level is complete the texture gets a new view
+// starting at it (the old one is destroyed after the frame), so sampling
+// never reaches levels that haven't arrived.
+class TextureStreamer {
+public:
+  // Level data (tightly packed rows, as copied into the image)
+  struct Level {
+    const void *data;
+    size_t size;
+
+    uint32_t width, height;
+  };
+
+  struct Source {
+    VkFormat format;
+
+    // Level 0 first
+    std::vector<Level> levels;
+
+    // Keeps the level data alive while streaming
+    std::shared_ptr<const void> owner;
+  };
+
+  struct Stats {
+    uint32_t textures = 0;
+    uint32_t streaming = 0; // textures below the level they were drawn at
+
+    VkDeviceSize frameBytes = 0; // uploaded by the current frame
+    VkDeviceSize uploaded = 0;   // so far
+  };
+
+  // Levels of a cooked texture (uploaded as stored)
+  static Source fromKtx2(std::shared_ptr<Ktx2Texture> texture);
+
+  TextureStreamer(VkDevice device, Allocator *allocator,
+                  DeletionQueue *deletions, uint32_t frames,
+                  VkDeviceSize budget = 4 * 1024 * 1024);
+  ~TextureStreamer();
+
+  // Stream the levels of an image finer than resident
+  // (levels from resident on must be uploaded & in SHADER_READ_ONLY)
+  uint32_t add(VkImage image, Source source, uint32_t resident);
+
+  // View of the levels resident so far (changes as levels arrive)
+  VkImageView view(uint32_t texture) const;
+
+  // Finest resident level
+  uint32_t resident(uint32_t texture) const;
+
+  // Report a draw of the texture, spanning about pixels on screen
+  // (the largest report of a frame sets its priority for the next one)
+  void report(uint32_t texture, float pixels);
+
+  // Pick & stage this frame's uploads, swapping views of completed levels
+  // (frame: slice of the frame in flight, serial: its frame serial)
+  void begin(uint32_t frame, uint64_t serial);
+
+  // Record this frame's copies (before the render pass)
+  void record(VkCommandBuffer commandBuffer);
+
+  Stats stats() const;
+
+private:
+  struct Stream {
+    VkImage image;
+    Source source;
+
+    // Texels per block side (4 for block-compressed formats)
+    uint32_t blockSize;
+
+    uint32_t resident;
+    VkImageView view;
+
+    // Block rows of the next level copied so far
+    uint32_t rowsDone = 0;
+
+    float pixels = 0.0f;    // priority (previous frame)
+    float reported = 0.0f;  // reports of the current frame
+  };
+
+  struct Copy {
+    uint32_t stream;
+    uint32_t level;
+    uint32_t firstRow, rows; // texel rows
+    VkDeviceSize offset;
+  };
+
+  VkDevice device;
+  Allocator *allocator;
+  DeletionQueue *deletions;
+
+  std::vector<Stream> streams;
+
+  // Upload Slices (host-visible, one per frame in flight)
+  VkBuffer upload;
+  Allocation uploadMemory;
+  VkDeviceSize budget;
+
+  // Current frame & what it uploads
+  uint32_t frame = 0;
+  uint64_t serial = 0;
+
+  std::vector<Copy> copies;
+  std::vector<std::pair<uint32_t, uint32_t>> started, completed;
+
+  Stats counters;
+
+private:
+  // Level the texture is drawn at (from the last frame's reports)
+  uint32_t wanted(const Stream &stream) const;
+
+  VkImageView createView(const Stream &stream, uint32_t level);
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "allocator.hpp"
+
+// Sampled Texture (full mip chain, or an array of layers viewed as one)
+struct Texture {
+  VkImage image = VK_NULL_HANDLE;
+  Allocation memory;
+  VkImageView view = VK_NULL_HANDLE;
+
+  VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+  uint32_t width = 0, height = 0;
+  uint32_t mipLevels = 1;
+  uint32_t layers = 1;
+};
+
+// Shared Texture Cache
+// (textures are keyed by canonical path & by the file contents, so the same
+// image is uploaded once no matter how it is referred to)
+//
+// Textures whose last handle went away stay cached & are registered with the
+// allocator as evictable, so acquiring them again costs nothing until memory
+// runs short; then the least recently released ones are freed first.
+class TextureManager {
+  struct Entry;
+
+public:
+  // Upload a batch of files (missing ones come back without an image)
+  using Loader =
+      std::function<std::vector<Texture>(const std::vector<std::string> &)>;
+  using Destroyer = std::function<void(Texture &)>;
+  using Evictor = std::function<void(Texture &)>;
+
+  // Reference-Counted Texture Handle
+  class Handle {
+  public:
+    Handle() = default;
+    Handle(const Handle &other);
+    Handle(Handle &&other);
+    Handle &operator=(Handle other);
+    ~Handle();
+
+    const Texture &operator*() const;
+    const Texture *operator->() const;
+
+    explicit operator bool() const;
+
+  private:
+    friend class TextureManager;
+
+    TextureManager *manager = nullptr;
+    Entry *entry = nullptr;
+
+    // (the reference must already be counted)
+    Handle(TextureManager *manager, Entry *entry);
+  };
+
+  struct Stats {
+    uint32_t textures = 0; // unique textures resident
+    uint32_t handles = 0;  // live handles to them
+    uint32_t cached = 0;   // resident without handles (evictable)
+    uint32_t evicted = 0;  // freed under memory pressure so far
+
+    uint32_t pathHits = 0;    // acquired through a known path
+    uint32_t contentHits = 0; // new path, but known contents
+
+    VkDeviceSize resident = 0; // bytes of device memory used
+    VkDeviceSize saved = 0;    // bytes duplicate uploads would have taken
+  };
+
+  // (destroy: once the frames in flight are done, e.g. deferred deletion;
+  // evict: right away, the GPU is done with an evicted texture already)
+  TextureManager(Allocator *allocator, Loader load, Destroyer destroy,
+                 Evictor evict);
+
+  // Every handle must have been released by now
+  ~TextureManager();
+
+  // Get textures, loading the ones not resident yet in one batch
+  // (invalid handles for files that failed to load)
+  std::vector<Handle> acquire(const std::vector<std::string> &paths);
+  Handle acquire(const std::string &path);
+
+  Stats stats();
+
+private:
+  struct Entry {
+    Texture texture = {};
+
+    // Fingerprint of the file contents (matches are confirmed byte by byte)
+    uint64_t hash = 0;
+    uint64_t size = 0;
+
+    uint32_t references = 0;
+
+    // While cached without handles (0 otherwise): allocator eviction handle
+    // & key in cached
+    uint64_t evictable = 0;
+    uint64_t cacheKey = 0;
+
+    // Every canonical path this texture was acquired through
+    std::vector<std::string> paths = {};
+  };
+
+  Allocator *allocator;
+
+  Loader load;
+  Destroyer destroy;
+  Evictor evict;
+
+  std::unordered_map<std::string, Entry *> byPath;
+  std::unordered_multimap<uint64_t, Entry *> byContent;
+
+  // Cached entries (an eviction may race a new acquire, so the allocator's
+  // callback looks its entry up here rather than holding on to it)
+  std::unordered_map<uint64_t, Entry *> cached;
+  uint64_t nextCacheKey = 1;
+
+  Stats counters;
+
+  std::mutex mutex;
+
+private:
+  void retain(Entry *entry);
+  void release(Entry *entry);
+
+  // Count a reference / make a handle holding a new one
+  // (with the lock held)
+  void adopt(Entry *entry);
+  Handle handle(Entry *entry);
+
+  // Make a path lead to an entry, unless it already leads somewhere
+  // (with the lock held)
+  void alias(Entry *entry, const std::string &path);
+
+  // Forget an entry & free its texture (with the lock held)
+  void remove(Entry *entry, const Destroyer &destroyer);
+
+  // Called by the allocator when a cached texture is chosen for eviction
+  void evicted(uint64_t cacheKey);
+
+  // Fingerprint of a file's contents, hashed a word at a time (false if it
+  // can't be read)
+  static bool hashFile(const std::string &path, uint64_t &hash,
+                       uint64_t &size);
+
+  // Whether two files have the same contents
+  static bool sameContents(const std::string &a, const std::string &b);
+};
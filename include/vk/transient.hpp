@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "allocator.hpp"
+
+// Transient Attachments
+// (render targets whose contents only live within a frame; attachments used
+// by passes that don't overlap share the same memory)
+//
+// Aliased attachments must be entered from VK_IMAGE_LAYOUT_UNDEFINED & be
+// cleared or fully overwritten at their first use each frame. Attachments
+// created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT are backed by lazily
+// allocated memory when the device has it.
+class TransientPool {
+public:
+  struct Report {
+    uint32_t attachments = 0;
+    uint32_t allocations = 0;
+
+    VkDeviceSize dedicated = 0; // bytes with one allocation per attachment
+    VkDeviceSize allocated = 0; // bytes actually allocated
+
+    uint32_t lazy = 0; // allocations in lazily allocated memory
+  };
+
+  TransientPool(VkDevice device, Allocator *allocator);
+  ~TransientPool();
+
+  // Declare an attachment used from pass firstPass to lastPass of a frame
+  // (the image has no memory, and can't get views, until build())
+  VkImage add(const VkImageCreateInfo &imageInfo, uint32_t firstPass,
+              uint32_t lastPass);
+
+  // Assign attachments to shared allocations & bind them
+  void build();
+
+  Report report() const;
+
+private:
+  struct Attachment {
+    VkImage image;
+    VkMemoryRequirements requirements;
+    uint32_t firstPass, lastPass;
+  };
+
+  // Memory shared by attachments with disjoint lifetimes
+  struct Slot {
+    VkMemoryRequirements requirements;
+    std::vector<uint32_t> attachments;
+    Allocation memory;
+  };
+
+  VkDevice device;
+  Allocator *allocator;
+
+  std::vector<Attachment> attachments;
+  std::vector<Slot> slots;
+
+  bool built = false;
+
+private:
+  bool overlaps(const Slot &slot, const Attachment &attachment) const;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+#include "allocator.hpp"
+
+// Persistently Mapped Uniform Arena
+// (one buffer split into a slice per frame in flight, sub-allocated linearly
+// each frame & bound through dynamic offsets)
+//
+// The arena is written in place when it lives in resizable BAR memory,
+// otherwise a host-visible shadow is written & copied over by record().
+class UniformArena {
+public:
+  struct Region {
+    uint32_t offset; // dynamic offset
+    void *mapped;
+  };
+
+  UniformArena(VkPhysicalDevice physicalDevice, Allocator *allocator,
+               uint32_t frames, VkDeviceSize frameSize = 1024 * 1024);
+  ~UniformArena();
+
+  // Start filling the slice of a frame
+  // (its previous contents must no longer be in use by the GPU)
+  void begin(uint32_t frame);
+
+  // Reserve an aligned region in the current frame's slice
+  Region allocate(VkDeviceSize size);
+
+  // Copy data into a new region (returns its dynamic offset)
+  template <typename T> uint32_t push(const T &data) {
+    Region region = allocate(sizeof(T));
+    memcpy(region.mapped, &data, sizeof(T));
+    return region.offset;
+  }
+
+  // Record the copy of the current frame's uniforms, if staged
+  // (before the render pass using them)
+  void record(VkCommandBuffer commandBuffer);
+
+  // Bytes used in the current frame / most used in any frame
+  VkDeviceSize used() const;
+  VkDeviceSize peak() const;
+
+  // Whether the arena is written directly (no staging copy)
+  bool direct() const;
+
+  VkBuffer buffer;
+
+  // Offset alignment (minUniformBufferOffsetAlignment)
+  VkDeviceSize alignment;
+
+private:
+  Allocator *allocator;
+
+  Allocation memory;
+  VkDeviceSize frameSize;
+
+  // Host-visible shadow (staged fallback only)
+  VkBuffer shadow = VK_NULL_HANDLE;
+  Allocation shadowMemory;
+
+  // Where the host writes (memory or shadow mapping)
+  char *mapped;
+
+  // Current slice & head inside of it
+  VkDeviceSize base = 0;
+  VkDeviceSize head = 0;
+
+  VkDeviceSize highWater = 0;
+};
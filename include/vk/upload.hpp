@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "staging.hpp"
+
+// Batched Uploads
+// (transfers & barriers share one command buffer, submitted with one fence)
+//
+// With a dedicated transfer queue family, written resources are released to
+// the graphics family and acquired there by a small graphics submission that
+// waits on a semaphore signaled by the transfer, so uploads overlap rendering.
+class UploadBatch {
+public:
+  struct Queue {
+    VkQueue queue;
+    VkCommandPool commandPool;
+    uint32_t family;
+  };
+
+  struct Stats {
+    uint32_t transfers = 0;   // recorded in total
+    uint32_t submissions = 0; // made in total
+
+    // Queue round trips saved compared to one submission per transfer
+    uint32_t roundTripsSaved = 0;
+
+    bool dedicated = false; // on a transfer queue family of its own
+  };
+
+  UploadBatch(VkDevice device, StagingRing *staging, Queue transfer,
+              Queue graphics);
+  ~UploadBatch();
+
+  // Command buffer to record a transfer into (begins recording if needed)
+  VkCommandBuffer record();
+
+  // Hand a resource written by this batch over to the graphics queue
+  // (a plain barrier if both queues are of the same family)
+  void releaseBuffer(VkBuffer buffer, VkAccessFlags dstAccess,
+                     VkPipelineStageFlags dstStage);
+  void releaseImage(VkImage image, VkImageLayout oldLayout,
+                    VkImageLayout newLayout, VkAccessFlags dstAccess,
+                    VkPipelineStageFlags dstStage, uint32_t mipLevels = 1,
+                    uint32_t layers = 1);
+
+  // Record work that needs the graphics queue (e.g. blits) on resources
+  // released by this batch (runs right after their acquire)
+  void recordGraphics(std::function<void(VkCommandBuffer)> record);
+
+  // Submit recorded transfers (returns the staging serial, 0 if empty)
+  uint64_t submit();
+
+  // Submit & wait for completion
+  void flush();
+
+  // Whether uploads run on a separate queue family
+  bool dedicated() const;
+
+  Stats stats() const;
+
+private:
+  // Queue Ownership Handoff (acquire submission on the graphics queue)
+  struct Handoff {
+    VkSemaphore semaphore;
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+  };
+
+  VkDevice device;
+  StagingRing *staging;
+
+  Queue transfer;
+  Queue graphics;
+
+  // Command buffer being recorded
+  VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+  bool recording = false;
+  uint64_t serial = 0;
+
+  uint32_t transferCount = 0;
+  uint32_t submissionCount = 0;
+
+  // Pending Acquire Barriers (recorded on the graphics queue)
+  std::vector<VkBufferMemoryBarrier> bufferAcquires;
+  std::vector<VkImageMemoryBarrier> imageAcquires;
+  VkPipelineStageFlags acquireStages = 0;
+
+  // Pending Graphics Work (recorded after the acquire barriers)
+  std::vector<std::function<void(VkCommandBuffer)>> graphicsWork;
+
+  std::vector<Handoff> handoffs;
+  std::vector<Handoff> freeHandoffs;
+
+  // Submitted Transfers (their command buffers are free again once the
+  // staging ring has seen their serial finish)
+  std::vector<std::pair<VkCommandBuffer, uint64_t>> inFlight;
+  std::vector<VkCommandBuffer> freeCommandBuffers;
+
+private:
+  VkCommandBuffer begin();
+
+  // Get an idle transfer command buffer (recycling finished ones)
+  VkCommandBuffer getCommandBuffer();
+
+  // Get an idle handoff (recycling finished ones)
+  Handoff getHandoff();
+};
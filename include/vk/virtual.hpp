@@ -0,0 +1,219 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <types/vtex.hpp>
+
+#include "allocator.hpp"
+#include "readback.hpp"
+
+// Virtual Texture (streams the tiles frames need out of a tiled file)
+//
+// Fragments set a bit per tile they want in a feedback bitmap (one pixel of
+// every 4x4 block per frame), read back asynchronously. Missing tiles are
+// read from the memory-mapped file on a loader thread & uploaded within a
+// per-frame budget into a fixed number of cache slots, reusing the least
+// recently requested ones. Coarser tiles are always loaded before finer ones
+// & the last level stays resident, so the shader can walk up the page table
+// to the finest resident level & always has something to sample.
+//
+// With sparse residency, tiles are bound to the pages of one sparse image of
+// the whole texture (no copies into a cache, but sampling is clamped to the
+// resident tile & its level, since neighbouring pages may be unbound);
+// otherwise they are copied into a tile cache sampled through the page table
+// (software indirection, e.g. on lavapipe). Sparse needs tiles matching the
+// standard block shape (128x128 for RGBA8).
+class VirtualTexture {
+public:
+  struct Options {
+    uint32_t cacheSlots = 1024;  // tiles resident at once
+    uint32_t tilesPerFrame = 16; // upload budget
+    bool sparse = false;         // sparse binding is enabled on the queue
+  };
+
+  // Shader Parameters (fragment push constants, see shaders/virtual)
+  struct Params {
+    float pages[2];
+    float tileSize, border;
+    float cacheSize;
+    uint32_t levels;
+    uint32_t jitter;
+    uint32_t pad;
+    uint32_t firstTile[16];
+  };
+
+  struct Stats {
+    uint32_t slots = 0;
+    uint32_t resident = 0;  // tiles in the cache
+    uint32_t requested = 0; // tiles wanted by the last feedback
+    uint32_t loading = 0;   // tiles queued for / on the loader thread
+
+    uint64_t uploaded = 0; // tiles uploaded so far
+    uint64_t evicted = 0;
+
+    bool sparse = false; // sparse residency, software indirection otherwise
+  };
+
+  VirtualTexture(VkPhysicalDevice physicalDevice, VkDevice device,
+                 Allocator *allocator, ReadbackQueue *readbacks,
+                 const char *path, uint32_t frames, Options options);
+  ~VirtualTexture();
+
+  // Descriptor set 1 of pipelines sampling it (tiles, page table, feedback)
+  VkDescriptorSetLayout setLayout;
+  VkDescriptorSet descriptorSet;
+
+  // Start a frame: take in feedback, queue loads & stage loaded tiles
+  // (frame: slice of the frame in flight, serial: its frame serial,
+  // completed: serial of the last finished frame)
+  void begin(uint32_t frame, uint64_t serial, uint64_t completed);
+
+  // Submit this frame's sparse binds (the frame must wait on the returned
+  // semaphore, VK_NULL_HANDLE if there is nothing to bind)
+  VkSemaphore bind(VkQueue queue);
+
+  // Record tile uploads & page table updates, clear the feedback
+  // (before the render pass)
+  void record(VkCommandBuffer commandBuffer);
+
+  // Read the feedback back (after the render pass)
+  void recordFeedback(VkCommandBuffer commandBuffer);
+
+  // Push constants & dynamic offset (feedback slice) of this frame
+  Params params() const;
+  uint32_t feedbackOffset() const;
+
+  // Whether tiles are bound to a sparse image (not copied into a cache)
+  bool sparse() const;
+
+  Stats stats();
+
+private:
+  enum class State : uint8_t { Absent, Loading, Resident };
+
+  struct Tile {
+    uint8_t level;
+    uint16_t x, y;
+
+    State state = State::Absent;
+    int32_t slot = -1;
+
+    uint64_t lastUse = 0;
+    uint8_t residentChildren = 0;
+  };
+
+  struct Loaded {
+    uint32_t tile;
+    std::vector<uint8_t> data;
+  };
+
+  // Slot evicted by a frame (its page is unbound once the frame finished)
+  struct Retired {
+    uint64_t serial;
+    uint32_t slot;
+    uint32_t tile;
+  };
+
+  // Page table entry write (slot & resident flag)
+  struct Entry {
+    uint32_t tile;
+    uint8_t value[4];
+  };
+
+  VkPhysicalDevice physicalDevice;
+  VkDevice device;
+  Allocator *allocator;
+  ReadbackQueue *readbacks;
+
+  TiledTexture file;
+  Options options;
+
+  std::vector<Tile> tiles;
+
+  // Tiles (software) or sparse image (sparse) & the page table
+  VkImage image;
+  Allocation imageMemory;
+  VkImageView imageView;
+  VkSampler sampler;
+
+  VkImage pageTable;
+  Allocation pageTableMemory;
+  VkImageView pageTableView;
+  VkSampler pageTableSampler;
+
+  // Memory pages bound to sparse tiles (one per slot)
+  Allocation pages;
+  VkDeviceSize pageSize = 0;
+  std::vector<VkSparseImageMemoryBind> binds;
+  std::vector<VkSemaphore> bindSemaphores;
+
+  // Cache Slots (slotsPerSide squared in the software cache)
+  uint32_t slotsPerSide;
+  std::vector<int32_t> slotTiles;
+  std::vector<uint32_t> freeSlots;
+
+  // Evicted slots, reusable once the frame unmapping them has finished
+  std::deque<Retired> retiring;
+
+  // Upload Slices (host-visible, one per frame in flight)
+  VkBuffer upload;
+  Allocation uploadMemory;
+  VkDeviceSize uploadSliceSize;
+
+  // Feedback Slices (device-local, one per frame in flight)
+  VkBuffer feedback;
+  Allocation feedbackMemory;
+  VkDeviceSize feedbackSliceSize;
+  uint32_t feedbackWords;
+
+  // Latest feedback that came back (a bit per tile)
+  std::vector<uint32_t> requested;
+  bool requestsChanged = false;
+
+  // Frame that took it in (tiles it requested are kept)
+  uint64_t feedbackSerial = 0;
+
+  VkDescriptorPool descriptorPool;
+
+  // Current frame & what it uploads
+  uint32_t frame = 0;
+  uint64_t serial = 0;
+  bool initialized = false;
+
+  std::vector<uint32_t> uploads; // tiles, in upload slice order
+  std::vector<Entry> entries;
+
+  // Loader Thread
+  std::thread loader;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping = false;
+
+  std::deque<uint32_t> loadQueue;
+  std::deque<Loaded> loaded;
+
+  Stats counters;
+
+private:
+  void createImages(const VkPhysicalDeviceProperties &properties);
+  bool createSparseImage();
+  void createDescriptors();
+
+  void load();
+
+  // Request a tile & its missing ancestors (keeping them all in use)
+  void request(uint32_t tile, std::vector<uint32_t> &wanted);
+
+  // Free a slot for reuse (evicting a leaf tile no longer requested)
+  bool evict();
+
+  void makeResident(uint32_t tile, uint32_t slot);
+
+  uint32_t tileIndex(uint32_t level, uint32_t x, uint32_t y) const;
+};
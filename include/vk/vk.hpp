@@ -1,8 +1,24 @@
 #pragma once
 
 #include <types.hpp>
+#include <types/atlas.hpp>
+#include <types/bc.hpp>
+#include <types/decode.hpp>
+#include <types/image.hpp>
+#include <types/ktx2.hpp>
 
+#include "allocator.hpp"
 #include "debug.hpp"
+#include "deletion.hpp"
+#include "readback.hpp"
+#include "samplers.hpp"
+#include "staging.hpp"
+#include "streaming.hpp"
+#include "textures.hpp"
+#include "transient.hpp"
+#include "uniform.hpp"
+#include "upload.hpp"
+#include "virtual.hpp"
 #include "window.hpp"
 
 // Status:
@@ -21,6 +37,63 @@ public:
 
   bool update();
 
+  // Memory Statistics (per-heap budget & usage, e.g. to alert on pressure)
+  Allocator::Stats getMemoryStats();
+  std::vector<Allocator::HeapBudget> getMemoryBudget();
+
+  // Read back the next rendered frame
+  // (raw pixels in the swap chain format, resolved once that frame has
+  // finished on the GPU)
+  std::future<std::vector<char>> capture();
+
+  // Decode & upload images on every hardware thread
+  // (pixels are decoded straight into staging memory; images that fail to
+  // load come back without an image)
+  //
+  // Grey & grey-alpha images stay R8 / RG8 & HDR images RGBA16F, all sampled
+  // as linear data; colour images are RGBA8, sRGB unless srgb is cleared
+  // (e.g. normal maps).
+  std::vector<Texture> loadTextures(const std::vector<std::string> &paths,
+                                    bool srgb = true);
+
+  // Pack many small images into one texture (viewed as 2D with a single
+  // layer, as a 2D array with more; regions tell where each image went, the
+  // caller remaps its texture coordinates with TextureAtlas::remap)
+  Texture loadAtlas(const std::vector<std::string> &paths,
+                    std::vector<TextureAtlas::Region> &regions,
+                    TextureAtlas::Mode mode = TextureAtlas::Mode::Atlas,
+                    bool srgb = true);
+
+  // Destroy a texture once the frames using it have finished
+  void destroyTexture(Texture &texture);
+
+  // Shared textures (loaded once per file contents, cached after the last
+  // handle until memory runs short)
+  std::vector<TextureManager::Handle>
+  acquireTextures(const std::vector<std::string> &paths);
+  TextureManager::Stats getTextureStats();
+
+  // Main texture (format & levels it ended up with, e.g. BC7 encoded on the
+  // CPU or a KTX2 file as stored)
+  VkFormat getTextureFormat();
+  uint32_t getTextureLevels();
+
+  // Texture Filtering (takes effect as each frame in flight comes round;
+  // anisotropy is 1 without samplerAnisotropy)
+  void setSamplerProfile(SamplerProfile profile);
+  SamplerProfile getSamplerProfile();
+  float getMaxAnisotropy();
+
+  // Upload Statistics (batching of transfers into submissions)
+  UploadBatch::Stats getUploadStats();
+
+  // Texture Streaming Statistics (levels still on their way)
+  TextureStreamer::Stats getStreamingStats();
+
+  // Virtual Texture Statistics (cache residency & streaming, all zero when
+  // there is no virtual texture)
+  VirtualTexture::Stats getVirtualTextureStats();
+
   // TODO
   void addPipeline();
 
@@ -41,12 +114,56 @@ private:
   VkQueue graphicsQueue;
   VkQueue presentQueue;
 
+  // Transfer Queue (graphicsQueue if there is no transfer-only family)
+  VkQueue transferQueue;
+
+  // Device Memory Allocator
+  Allocator *allocator = nullptr;
+  bool memoryBudgetSupported = false;
+
+  // Block-compressed (BC1-BC7) textures can be sampled
+  bool textureCompressionBC = false;
+
+  // Anisotropic filtering is available (samplers go without otherwise)
+  bool samplerAnisotropy = false;
+
+  // Fragment shaders can write storage buffers (virtual texture feedback)
+  bool fragmentStoresAndAtomics = false;
+
+  // Sparse images can be bound on the graphics queue
+  bool sparseResidency = false;
+
+  // Staging Ring (all uploads go through it, except ones too large for it)
+  StagingRing *staging = nullptr;
+
+  // Staging buffers of uploads too large for the ring (freed once the
+  // uploads reading them have finished)
+  std::vector<std::pair<VkBuffer, Allocation>> stagingBuffers;
+
+  // Deferred Destruction (keyed by frame serial)
+  DeletionQueue *deletions = nullptr;
+
+  // GPU Readback (keyed by frame serial)
+  ReadbackQueue *readbacks = nullptr;
+
+  // Texture Cache (shared, reference-counted textures)
+  TextureManager *textures = nullptr;
+
+  // Texture Streaming (levels refined by screen-space priority)
+  TextureStreamer *streamer = nullptr;
+
+  // Virtual Texture (tiles streamed on demand, optional)
+  VirtualTexture *virtualTexture = nullptr;
+
+  // Captures waiting for the next recorded frame
+  std::vector<std::promise<std::vector<char>>> captures;
+
   // Required Device Extensions
   const std::vector<const char *> deviceExtensions = {
       VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
   // Swap Chain
-  VkSwapchainKHR swapChain;
+  VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 
   // Swap Chain Images
   std::vector<VkImage> swapChainImages;
@@ -54,6 +171,9 @@ private:
   VkFormat swapChainImageFormat;
   VkExtent2D swapChainExtent;
 
+  // Whether swap chain images can be copied from (captures)
+  bool swapChainReadable = false;
+
   // Swap Chain Image Views
   std::vector<VkImageView> swapChainImageViews;
 
@@ -70,8 +190,12 @@ private:
   // Framebuffers
   std::vector<VkFramebuffer> swapChainFramebuffers;
 
-  // Command Pool
+  // Command Pools
   VkCommandPool commandPool;
+  VkCommandPool transferCommandPool;
+
+  // Upload Batch (transfers are submitted together)
+  UploadBatch *uploads = nullptr;
 
   // Command Buffer
   std::vector<VkCommandBuffer> commandBuffers;
@@ -86,34 +210,56 @@ private:
   // Current Frame
   uint32_t currentFrame = 0;
 
+  // Frames started so far (frame serial, the first frame is 1)
+  uint64_t frameCount = 0;
+
   // Vertex Indices
   Model model;
 
+  // Bounding sphere radius of the model (around its origin)
+  float modelRadius = 0.0f;
+
   // Vertex Buffer
   VkBuffer vertexBuffer;
-  VkDeviceMemory vertexBufferMemory;
+  Allocation vertexBufferMemory;
 
   // Index Buffer
   VkBuffer indexBuffer;
-  VkDeviceMemory indexBufferMemory;
+  Allocation indexBufferMemory;
 
-  std::vector<VkBuffer> uniformBuffers;
-  std::vector<VkDeviceMemory> uniformBuffersMemory;
-  std::vector<void *> uniformBuffersMapped;
+  // Uniform Arena (per-draw data, bound with dynamic offsets)
+  UniformArena *uniforms = nullptr;
 
   // Descriptor Pool
   VkDescriptorPool descriptorPool;
+
+  // Descriptor Sets (one per frame in flight, so the texture view can change
+  // between frames) & the view each one was written with
   std::vector<VkDescriptorSet> descriptorSets;
+  std::vector<VkImageView> descriptorViews;
 
   VkImage textureImage;
-  VkDeviceMemory textureImageMemory;
-  VkImageView textureImageView;
+  Allocation textureImageMemory;
+  VkImageView textureImageView = VK_NULL_HANDLE;
+
+  // Streamed texture (its views come from the streamer), -1 if uploaded whole
+  int32_t streamedTexture = -1;
+
+  // Texture Format & Mip Levels (full chain)
+  VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+  uint32_t mipLevels = 1;
 
+  // Sampler Cache (shared samplers, one per description)
+  SamplerCache *samplers = nullptr;
+
+  SamplerProfile samplerProfile = SamplerProfile::Quality;
   VkSampler textureSampler;
 
-  // Depth Buffer (Image)
+  // Transient Attachments (rebuilt with the swap chain)
+  TransientPool *transients = nullptr;
+
+  // Depth Buffer (Image, transient)
   VkImage depthImage;
-  VkDeviceMemory depthImageMemory;
   VkImageView depthImageView;
 
 private:
@@ -133,6 +279,8 @@ private:
   void createLogicalDevice();
 
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool checkDeviceExtensionSupport(VkPhysicalDevice device,
+                                   const char *extension);
 
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
@@ -161,62 +309,97 @@ private:
 
   void createCommandBuffers();
 
-  void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+  void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+                           uint32_t uniformOffset);
 
   void createSyncObjects();
 
   void drawFrame();
 
+  // Queue the swap chain & its resources for destruction
   void cleanupSwapChain();
 
   void recreateSwapChain();
 
   void createVertexBuffer();
 
-  uint32_t findMemoryType(uint32_t typeFilter,
-                          VkMemoryPropertyFlags properties);
-
   void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-                    VkMemoryPropertyFlags properties, VkBuffer &buffer,
-                    VkDeviceMemory &bufferMemory);
+                    MemoryUsage memoryUsage, VkBuffer &buffer,
+                    Allocation &bufferMemory);
 
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size,
+                  VkDeviceSize srcOffset = 0);
 
   void createIndexBuffer();
 
+  // Reserve staging memory for an upload (a buffer of its own if the ring
+  // can't hold it)
+  StagingRing::Region allocateStaging(VkDeviceSize size);
+
+  // Submit recorded uploads (waiting for them to free their own buffers)
+  void submitUploads();
+
   void createDescriptorSetLayout();
 
   void createUniformBuffers();
 
-  void updateUniformBuffer(uint32_t currentImage);
+  // Write this frame's uniforms (returns their dynamic offset)
+  uint32_t updateUniformBuffer();
 
   void createDescriptorPool();
 
   void createDescriptorSets();
 
-  void createTextureImage();
+  // Point a frame's set at the current texture view (once its frame is done)
+  void updateDescriptorSet(uint32_t frame);
 
-  void createImage(uint32_t width, uint32_t height, VkFormat format,
-                   VkImageTiling tiling, VkImageUsageFlags usage,
-                   VkMemoryPropertyFlags properties, VkImage &image,
-                   VkDeviceMemory &imageMemory);
+  // Current view of the texture (streamed views change as levels arrive)
+  VkImageView textureView();
+
+  void createTextureImage();
 
-  VkCommandBuffer beginSingleTimeCommands();
+  // Upload the smallest levels of a cooked KTX2 texture & stream the rest
+  // (false if it is missing or its format can't be sampled)
+  bool createTextureImageKtx2(const char *path);
 
-  void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+  void createImage(uint32_t width, uint32_t height, uint32_t mipLevels,
+                   VkFormat format, VkImageTiling tiling,
+                   VkImageUsageFlags usage, MemoryUsage memoryUsage,
+                   VkImage &image, Allocation &imageMemory,
+                   uint32_t arrayLayers = 1);
 
   void transitionImageLayout(VkImage image, VkFormat format,
-                             VkImageLayout oldLayout, VkImageLayout newLayout);
+                             VkImageLayout oldLayout, VkImageLayout newLayout,
+                             uint32_t mipLevels = 1, uint32_t layers = 1);
 
   void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
-                         uint32_t height);
+                         uint32_t height, VkDeviceSize bufferOffset = 0,
+                         uint32_t mipLevel = 0, uint32_t layer = 0);
+
+  // Whether a format has all features with optimal tiling
+  bool supportsFormat(VkFormat format, VkFormatFeatureFlags features);
+
+  // Whether a format can generate its mip chain with linear blits
+  bool supportsLinearBlit(VkFormat format);
+
+  // Blit each level from the previous one (on the graphics queue)
+  // (expects every level in TRANSFER_DST, leaves them in SHADER_READ_ONLY)
+  void generateMipmaps(VkImage image, int32_t width, int32_t height,
+                       uint32_t mipLevels);
 
   VkImageView createImageView(VkImage image, VkFormat format,
-                              VkImageAspectFlags = VK_IMAGE_ASPECT_COLOR_BIT);
+                              VkImageAspectFlags = VK_IMAGE_ASPECT_COLOR_BIT,
+                              uint32_t mipLevels = 1,
+                              VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
+                              uint32_t layers = 1);
 
   void createTextureImageView();
   void createTextureSampler();
 
+  // Stream a tiled texture instead (if it, its shaders & the features it
+  // needs are there)
+  void createVirtualTexture(const char *path);
+
   void createDepthResources();
 
   VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates,
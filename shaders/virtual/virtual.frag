@@ -0,0 +1,91 @@
+#version 450
+
+// Virtual Texture (see include/vk/virtual.hpp)
+// (compiled twice: frag.spv samples the tile cache through the page table,
+// sparse.spv, with -DSPARSE, samples the sparse image directly)
+
+layout (location = 0) out vec4 outColor;
+layout (location = 0) in vec2 fragTexCoord;
+
+// Tile cache (software) or the virtual image itself (sparse)
+layout (set = 1, binding = 0) uniform sampler2D tiles;
+
+// Page table (a level per virtual level, entries: cache slot x, y, resident)
+layout (set = 1, binding = 1) uniform usampler2D pageTable;
+
+// Feedback (a bit per tile, set for the tiles this frame wants)
+layout (set = 1, binding = 2) buffer Feedback {
+    uint requested[];
+};
+
+layout (push_constant) uniform Params {
+    vec2 pages;       // tiles of level 0
+    float tileSize;   // texels per tile side, without the border
+    float border;
+    float cacheSize;  // texels per side of the tile cache
+    uint levels;
+    uint jitter;      // pixel of every 4x4 block writing feedback
+    uint pad;
+    uvec4 firstTile[4];
+} params;
+
+ivec2 pageOf(vec2 uv, uint level) {
+    ivec2 pages = ivec2(params.pages) >> level;
+    return min(ivec2(uv * vec2(pages)), pages - 1);
+}
+
+void main() {
+    vec2 uv = fract(fragTexCoord);
+
+    // Level the hardware would pick for this footprint
+    vec2 texel = fragTexCoord * params.pages * params.tileSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0,
+                      float(params.levels - 1));
+
+    uint level = uint(lod);
+
+    // Request the tile (from one pixel of every 4x4 block per frame)
+    ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+    if (uint(pixel.x + pixel.y * 4) == params.jitter) {
+        ivec2 page = pageOf(uv, level);
+        uint index = params.firstTile[level / 4][level % 4] +
+                     uint(page.y) * (uint(params.pages.x) >> level) +
+                     uint(page.x);
+
+        atomicOr(requested[index / 32], 1u << (index % 32));
+    }
+
+    // Finest resident level (coarser tiles are always loaded first)
+    uint resident = level;
+    uvec4 entry = uvec4(0);
+
+    for (; resident < params.levels; resident++) {
+        entry = texelFetch(pageTable, pageOf(uv, resident), int(resident));
+        if (entry.a != 0)
+            break;
+    }
+
+    if (resident == params.levels) {
+        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+#ifdef SPARSE
+    // Only the tile found above is sampled, at its own level (filtering into
+    // a neighbour, whose pages may be unbound, is undefined)
+    vec2 size = vec2(ivec2(params.pages) >> resident) * params.tileSize;
+    vec2 first = vec2(pageOf(uv, resident)) * params.tileSize;
+    vec2 at = clamp(uv * size, first + 0.5, first + params.tileSize - 0.5);
+
+    outColor = textureLod(tiles, at / size, float(resident));
+#else
+    vec2 within = uv * vec2(ivec2(params.pages) >> resident) -
+                  vec2(pageOf(uv, resident));
+
+    vec2 cached = vec2(entry.xy) * (params.tileSize + 2.0 * params.border) +
+                  params.border + within * params.tileSize;
+
+    outColor = textureLod(tiles, cached / params.cacheSize, 0.0);
+#endif
+}
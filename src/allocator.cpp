@@ -0,0 +1,606 @@
+#include <vk/allocator.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+const VkDeviceSize MB = 1024 * 1024;
+
+const VkMemoryPropertyFlags HOST_MEMORY = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+// Smallest power of two >= v
+static VkDeviceSize nextPowerOfTwo(VkDeviceSize v) {
+  VkDeviceSize out = 1;
+  while (out < v)
+    out <<= 1;
+  return out;
+}
+
+static int32_t bitCount(VkMemoryPropertyFlags flags) {
+  int32_t count = 0;
+  for (; flags; flags &= flags - 1)
+    count++;
+  return count;
+}
+
+// Memory Type Scoring (per usage class)
+struct UsageFlags {
+  VkMemoryPropertyFlags required;
+  VkMemoryPropertyFlags preferred; // +1 per flag present
+  VkMemoryPropertyFlags unwanted;  // -1 per flag present
+};
+
+static UsageFlags usageFlags(MemoryUsage usage, bool rebar) {
+  const VkMemoryPropertyFlags local = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  const VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+  const VkMemoryPropertyFlags lazy = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+  switch (usage) {
+  case MemoryUsage::Dynamic:
+    if (rebar)
+      return {local | HOST_MEMORY, 0, cached};
+    return {local, 0, HOST_MEMORY | cached};
+  case MemoryUsage::Staging:
+    return {HOST_MEMORY, 0, local | cached};
+  case MemoryUsage::Readback:
+    return {HOST_MEMORY, cached, local};
+  case MemoryUsage::Transient:
+    return {local, lazy, HOST_MEMORY | cached};
+  default:
+    // Keep host-visible device memory (the BAR) free for dynamic data
+    return {local, 0, HOST_MEMORY | cached};
+  }
+}
+
+// Memory Block
+
+uint32_t MemoryBlock::levelOf(VkDeviceSize nodeSize) const {
+  uint32_t level = 0;
+  for (VkDeviceSize s = size; s > nodeSize; s >>= 1)
+    level++;
+  return level;
+}
+
+bool MemoryBlock::allocate(uint32_t level, VkDeviceSize &offset) {
+  // Find the smallest free node that fits
+  int64_t l = level;
+  while (l >= 0 && free[l].empty())
+    l--;
+
+  if (l < 0)
+    return false;
+
+  offset = *free[l].begin();
+  free[l].erase(free[l].begin());
+
+  // Split it down, keeping the upper halves free
+  for (uint32_t k = l + 1; k <= level; k++)
+    free[k].insert(offset + (size >> k));
+
+  used += size >> level;
+  return true;
+}
+
+void MemoryBlock::release(uint32_t level, VkDeviceSize offset) {
+  used -= size >> level;
+
+  // Merge with free buddies
+  for (; level > 0; level--) {
+    VkDeviceSize buddy = offset ^ (size >> level);
+    if (!free[level].erase(buddy))
+      break;
+    offset = std::min(offset, buddy);
+  }
+
+  free[level].insert(offset);
+}
+
+// Allocator
+
+Allocator::Allocator(VkPhysicalDevice physicalDevice, VkDevice device,
+                     bool memoryBudget)
+    : physicalDevice(physicalDevice), device(device),
+      memoryBudget(memoryBudget) {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  bufferImageGranularity = properties.limits.bufferImageGranularity;
+
+  // Resizable BAR: host-visible device-local memory beyond the legacy 256 MB
+  // window (integrated GPUs & software drivers expose all of their memory so)
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    const VkMemoryType &type = memProperties.memoryTypes[i];
+    if ((type.propertyFlags & (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                               HOST_MEMORY)) ==
+            (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | HOST_MEMORY) &&
+        memProperties.memoryHeaps[type.heapIndex].size > 256 * MB)
+      hasRebar = true;
+  }
+
+  // Force the staged fallback (e.g. to exercise it on software drivers)
+  const char *noRebar = getenv("VULKAN_BASE_NO_REBAR");
+  if (noRebar && strcmp(noRebar, "0") != 0)
+    hasRebar = false;
+
+  heaps.resize(memProperties.memoryHeapCount);
+  for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+    heaps[i].size = memProperties.memoryHeaps[i].size;
+
+  queryBudget();
+}
+
+Allocator::~Allocator() {
+  for (auto &type : pools)
+    for (auto &pool : type)
+      for (MemoryBlock *block : pool) {
+        vkFreeMemory(device, block->memory, nullptr);
+        delete block;
+      }
+}
+
+uint32_t Allocator::findMemoryType(uint32_t typeFilter,
+                                   VkMemoryPropertyFlags properties) {
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    if (typeFilter & (1 << i) &&
+        (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      return i;
+
+  throw std::runtime_error("failed to find suitable memory type");
+}
+
+uint32_t Allocator::findMemoryType(uint32_t typeFilter, MemoryUsage usage) {
+  UsageFlags flags = usageFlags(usage, hasRebar);
+
+  // Resources that can't live in the BAR fall back to staged writes
+  for (int attempt = 0; attempt < 2; attempt++) {
+    int32_t bestScore = INT32_MIN;
+    uint32_t best = 0;
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+      VkMemoryPropertyFlags properties =
+          memProperties.memoryTypes[i].propertyFlags;
+
+      // Lazily allocated memory only backs transient attachments
+      if (!(typeFilter & (1 << i)) ||
+          (properties & flags.required) != flags.required ||
+          properties & VK_MEMORY_PROPERTY_PROTECTED_BIT ||
+          (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT &&
+           usage != MemoryUsage::Transient))
+        continue;
+
+      int32_t score = bitCount(properties & flags.preferred) -
+                      bitCount(properties & flags.unwanted);
+      if (score > bestScore) {
+        bestScore = score;
+        best = i;
+      }
+    }
+
+    if (bestScore != INT32_MIN)
+      return best;
+
+    if (usage != MemoryUsage::Dynamic)
+      break;
+    flags = usageFlags(usage, false);
+  }
+
+  throw std::runtime_error("failed to find suitable memory type");
+}
+
+Allocation Allocator::allocate(const VkMemoryRequirements &requirements,
+                               MemoryUsage usage, bool linear) {
+  uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, usage);
+  uint32_t heap = memProperties.memoryTypes[memoryType].heapIndex;
+
+  // Only usages written or read by the host get a mapped pointer
+  bool hostAccess =
+      usage != MemoryUsage::Static &&
+      (memProperties.memoryTypes[memoryType].propertyFlags & HOST_MEMORY) ==
+          HOST_MEMORY &&
+      (usage != MemoryUsage::Dynamic || hasRebar);
+
+  // Buddy nodes are aligned to their own size, so rounding up to the
+  // alignment is enough to satisfy it
+  VkDeviceSize nodeSize = nextPowerOfTwo(
+      std::max({requirements.size, requirements.alignment, minNodeSize}));
+
+  // Evict streamed resources rather than going over budget, and only
+  // exceed it once there is nothing left to evict
+  bool dedicated = usage == MemoryUsage::Transient;
+
+  Allocation out;
+  while (!tryAllocate(requirements.size, nodeSize, memoryType, linear,
+                      dedicated, false, out))
+    if (!evict(heap)) {
+      tryAllocate(requirements.size, nodeSize, memoryType, linear, dedicated,
+                  true, out);
+      break;
+    }
+
+  if (!hostAccess)
+    out.mapped = nullptr;
+
+  return out;
+}
+
+void Allocator::free(Allocation &allocation) {
+  if (allocation.memory == VK_NULL_HANDLE)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  MemoryBlock *block = allocation.block;
+  uint32_t heap = memProperties.memoryTypes[allocation.memoryType].heapIndex;
+
+  stats.allocations--;
+  stats.requested -= allocation.size;
+  heaps[heap].allocations--;
+
+  if (!block) {
+    freeMemory(allocation.memory, allocation.size, allocation.memoryType);
+
+    stats.dedicated--;
+    stats.used -= allocation.size;
+    heaps[heap].used -= allocation.size;
+  } else {
+    block->release(allocation.level, allocation.offset);
+    stats.used -= block->size >> allocation.level;
+    heaps[heap].used -= block->size >> allocation.level;
+
+    // Release empty blocks, but keep one per pool to avoid thrashing
+    if (block->used == 0)
+      for (auto &pool : pools[allocation.memoryType]) {
+        auto it = std::find(pool.begin(), pool.end(), block);
+        if (it == pool.end())
+          continue;
+
+        if (pool.size() > 1) {
+          pool.erase(it);
+          freeMemory(block->memory, block->size, allocation.memoryType);
+
+          stats.blocks--;
+          delete block;
+        }
+        break;
+      }
+  }
+
+  allocation = Allocation{};
+}
+
+void Allocator::createBuffer(const VkBufferCreateInfo &bufferInfo,
+                             MemoryUsage usage, VkBuffer &buffer,
+                             Allocation &allocation) {
+  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    throw std::runtime_error("failed to create buffer");
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+  allocation = allocate(memRequirements, usage, true);
+
+  vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+}
+
+void Allocator::createImage(const VkImageCreateInfo &imageInfo,
+                            MemoryUsage usage, VkImage &image,
+                            Allocation &allocation) {
+  if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    throw std::runtime_error("failed to create image");
+
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+  allocation = allocate(memRequirements, usage,
+                        imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+
+  vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+}
+
+void Allocator::destroyBuffer(VkBuffer buffer, Allocation &allocation) {
+  vkDestroyBuffer(device, buffer, nullptr);
+  free(allocation);
+}
+
+void Allocator::destroyImage(VkImage image, Allocation &allocation) {
+  vkDestroyImage(device, image, nullptr);
+  free(allocation);
+}
+
+Allocator::Stats Allocator::getStats() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  Stats out = stats;
+  out.memoryBudget = memoryBudget;
+  out.rebar = hasRebar;
+  return out;
+}
+
+std::vector<Allocator::HeapBudget> Allocator::getBudget() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::vector<HeapBudget> out = heaps;
+  for (uint32_t i = 0; i < out.size(); i++)
+    out[i].usage = heapUsage(i);
+
+  return out;
+}
+
+float Allocator::pressure() {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  float out = 0.0f;
+  for (uint32_t i = 0; i < heaps.size(); i++)
+    if (heaps[i].budget > 0)
+      out = std::max(out, static_cast<float>(heapUsage(i)) / heaps[i].budget);
+
+  return out;
+}
+
+uint64_t Allocator::addEvictable(const Allocation &allocation,
+                                 std::function<void()> evict) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  uint64_t handle = nextEvictable++;
+  evictables[handle] = {
+      memProperties.memoryTypes[allocation.memoryType].heapIndex,
+      allocation.size, frame, std::move(evict)};
+
+  return handle;
+}
+
+void Allocator::removeEvictable(uint64_t handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  evictables.erase(handle);
+}
+
+void Allocator::touch(uint64_t handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto it = evictables.find(handle);
+  if (it != evictables.end())
+    it->second.lastUse = frame;
+}
+
+void Allocator::beginFrame(uint64_t frame, uint64_t completed) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  this->frame = frame;
+  completedFrame = completed;
+
+  queryBudget();
+}
+
+VkMemoryPropertyFlags Allocator::memoryProperties(uint32_t memoryType) const {
+  return memProperties.memoryTypes[memoryType].propertyFlags;
+}
+
+bool Allocator::rebar() const { return hasRebar; }
+
+VkDeviceSize Allocator::blockSize(uint32_t memoryType) {
+  VkDeviceSize heapSize =
+      memProperties.memoryHeaps[memProperties.memoryTypes[memoryType].heapIndex]
+          .size;
+
+  // Small heaps (e.g. 256 MB host-visible device memory) get smaller blocks
+  VkDeviceSize size = heapSize >= 4096 * MB ? 256 * MB : 64 * MB;
+  while (size > heapSize / 8 && size > MB)
+    size /= 2;
+
+  return size;
+}
+
+VkDeviceMemory Allocator::allocateMemory(VkDeviceSize size, uint32_t memoryType,
+                                         void **mapped) {
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryType;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    throw std::runtime_error("failed to allocate device memory");
+
+  // Map host-visible memory once for its whole lifetime
+  *mapped = nullptr;
+  if (memProperties.memoryTypes[memoryType].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+
+  stats.reserved += size;
+  heaps[memProperties.memoryTypes[memoryType].heapIndex].reserved += size;
+
+  return memory;
+}
+
+void Allocator::freeMemory(VkDeviceMemory memory, VkDeviceSize size,
+                           uint32_t memoryType) {
+  vkFreeMemory(device, memory, nullptr);
+
+  stats.reserved -= size;
+  heaps[memProperties.memoryTypes[memoryType].heapIndex].reserved -= size;
+}
+
+Allocation Allocator::allocateDedicated(VkDeviceSize size,
+                                        uint32_t memoryType) {
+  Allocation out;
+  out.memory = allocateMemory(size, memoryType, &out.mapped);
+  out.size = size;
+  out.memoryType = memoryType;
+
+  HeapBudget &heap = heaps[memProperties.memoryTypes[memoryType].heapIndex];
+
+  stats.dedicated++;
+  stats.allocations++;
+  stats.used += size;
+  stats.requested += size;
+
+  heap.allocations++;
+  heap.used += size;
+
+  return out;
+}
+
+bool Allocator::tryAllocate(VkDeviceSize size, VkDeviceSize nodeSize,
+                            uint32_t memoryType, bool linear, bool dedicated,
+                            bool overBudget, Allocation &out) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  uint32_t heap = memProperties.memoryTypes[memoryType].heapIndex;
+
+  // Large resources get their own memory
+  VkDeviceSize preferred = blockSize(memoryType);
+  if (dedicated || nodeSize > preferred / 2) {
+    if (!overBudget && !fitsBudget(heap, size))
+      return false;
+
+    try {
+      out = allocateDedicated(size, memoryType);
+    } catch (const std::runtime_error &) {
+      if (overBudget)
+        throw;
+      return false;
+    }
+    return true;
+  }
+
+  // Without granularity constraints linear & optimal resources share blocks
+  auto &pool = pools[memoryType][bufferImageGranularity > 1 && !linear];
+
+  out = Allocation{};
+  out.memoryType = memoryType;
+  out.size = size;
+
+  for (MemoryBlock *block : pool) {
+    if (block->size - block->used < nodeSize)
+      continue;
+
+    uint32_t level = block->levelOf(nodeSize);
+    if (block->allocate(level, out.offset)) {
+      out.memory = block->memory;
+      out.block = block;
+      out.level = level;
+      break;
+    }
+  }
+
+  // Grow the pool (halving the block size if the heap is short on memory)
+  if (!out.block) {
+    VkDeviceSize blockSize = preferred;
+    if (!overBudget) {
+      while (blockSize / 2 >= nodeSize && !fitsBudget(heap, blockSize))
+        blockSize /= 2;
+      if (!fitsBudget(heap, blockSize))
+        return false;
+    }
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void *mapped;
+
+    while (!memory)
+      try {
+        memory = allocateMemory(blockSize, memoryType, &mapped);
+      } catch (const std::runtime_error &) {
+        if (blockSize / 2 < nodeSize) {
+          if (overBudget)
+            throw;
+          return false;
+        }
+        blockSize /= 2;
+      }
+
+    MemoryBlock *block =
+        new MemoryBlock{memory, blockSize, static_cast<char *>(mapped)};
+    block->free.resize(block->levelOf(minNodeSize) + 1);
+    block->free[0].insert(0);
+    pool.push_back(block);
+
+    stats.blocks++;
+
+    out.level = block->levelOf(nodeSize);
+    block->allocate(out.level, out.offset);
+    out.memory = block->memory;
+    out.block = block;
+  }
+
+  if (out.block->mapped)
+    out.mapped = out.block->mapped + out.offset;
+
+  stats.allocations++;
+  stats.used += nodeSize;
+  stats.requested += out.size;
+
+  heaps[heap].allocations++;
+  heaps[heap].used += nodeSize;
+
+  return true;
+}
+
+VkDeviceSize Allocator::heapUsage(uint32_t heap) const {
+  // Driver usage at the last query, plus what was allocated since
+  return heaps[heap].usage + heaps[heap].reserved - reservedAtQuery[heap];
+}
+
+bool Allocator::fitsBudget(uint32_t heap, VkDeviceSize size) const {
+  return heapUsage(heap) + size <= heaps[heap].budget;
+}
+
+bool Allocator::evict(uint32_t heap) {
+  std::function<void()> callback;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Least recently used resource the GPU is done with
+    auto victim = evictables.end();
+    for (auto it = evictables.begin(); it != evictables.end(); it++)
+      if (it->second.heap == heap && it->second.lastUse <= completedFrame &&
+          (victim == evictables.end() ||
+           it->second.lastUse < victim->second.lastUse))
+        victim = it;
+
+    if (victim == evictables.end())
+      return false;
+
+    stats.evictions++;
+    stats.evicted += victim->second.size;
+
+    callback = std::move(victim->second.evict);
+    evictables.erase(victim);
+  }
+
+  // Outside of the lock, the callback frees the resource's memory
+  callback();
+  return true;
+}
+
+void Allocator::queryBudget() {
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+  budgetProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+  VkPhysicalDeviceMemoryProperties2 properties{};
+  properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+  properties.pNext = &budgetProperties;
+
+  if (memoryBudget)
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties);
+
+  for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+    HeapBudget &heap = heaps[i];
+
+    if (memoryBudget && budgetProperties.heapBudget[i] > 0) {
+      heap.budget = std::min(budgetProperties.heapBudget[i], heap.size);
+      heap.usage = budgetProperties.heapUsage[i];
+    } else {
+      // Without the extension leave room for other processes & the driver
+      heap.budget = heap.size / 10 * 8;
+      heap.usage = heap.reserved;
+    }
+
+    reservedAtQuery[i] = heap.reserved;
+  }
+}
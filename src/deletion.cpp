@@ -0,0 +1,31 @@
+#include <vk/deletion.hpp>
+
+DeletionQueue::~DeletionQueue() { flush(); }
+
+void DeletionQueue::push(uint64_t frame, std::function<void()> destroy) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.push_back({frame, std::move(destroy)});
+}
+
+void DeletionQueue::collect(uint64_t completed) {
+  std::deque<Entry> ready;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!entries.empty() && entries.front().frame <= completed) {
+      ready.push_back(std::move(entries.front()));
+      entries.pop_front();
+    }
+  }
+
+  // Outside of the lock, destroying may queue more work
+  for (Entry &entry : ready)
+    entry.destroy();
+}
+
+void DeletionQueue::flush() { collect(UINT64_MAX); }
+
+size_t DeletionQueue::pending() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
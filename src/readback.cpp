@@ -0,0 +1,219 @@
+#include <vk/readback.hpp>
+
+#include <algorithm>
+#include <memory>
+
+// Smallest pooled buffer (tiny readbacks like statistics share sizes)
+const VkDeviceSize MIN_BUFFER_SIZE = 64 * 1024;
+
+ReadbackQueue::Callback
+ReadbackQueue::fulfil(std::promise<std::vector<char>> promise) {
+  auto shared =
+      std::make_shared<std::promise<std::vector<char>>>(std::move(promise));
+
+  return [shared](const void *data, VkDeviceSize size) {
+    const char *bytes = static_cast<const char *>(data);
+    shared->set_value(std::vector<char>(bytes, bytes + size));
+  };
+}
+
+ReadbackQueue::ReadbackQueue(VkDevice device, Allocator *allocator)
+    : device(device), allocator(allocator) {}
+
+ReadbackQueue::~ReadbackQueue() {
+  flush();
+
+  for (Buffer &buffer : pool)
+    allocator->destroyBuffer(buffer.buffer, buffer.memory);
+}
+
+void ReadbackQueue::readBuffer(VkCommandBuffer commandBuffer, uint64_t frame,
+                               VkBuffer buffer, VkDeviceSize offset,
+                               VkDeviceSize size, Callback done) {
+  Buffer target = acquire(size);
+
+  // Wait for earlier writes to the source
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = offset;
+  copyRegion.dstOffset = 0;
+  copyRegion.size = size;
+  vkCmdCopyBuffer(commandBuffer, buffer, target.buffer, 1, &copyRegion);
+
+  finish(commandBuffer, frame, target, size, std::move(done));
+}
+
+std::future<std::vector<char>>
+ReadbackQueue::readBuffer(VkCommandBuffer commandBuffer, uint64_t frame,
+                          VkBuffer buffer, VkDeviceSize offset,
+                          VkDeviceSize size) {
+  std::promise<std::vector<char>> promise;
+  std::future<std::vector<char>> future = promise.get_future();
+
+  readBuffer(commandBuffer, frame, buffer, offset, size,
+             fulfil(std::move(promise)));
+  return future;
+}
+
+void ReadbackQueue::readImage(VkCommandBuffer commandBuffer, uint64_t frame,
+                              VkImage image, VkImageLayout layout,
+                              VkExtent2D extent, uint32_t texelSize,
+                              Callback done) {
+  VkDeviceSize size =
+      static_cast<VkDeviceSize>(extent.width) * extent.height * texelSize;
+  Buffer target = acquire(size);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.oldLayout = layout;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {extent.width, extent.height, 1};
+
+  vkCmdCopyImageToBuffer(commandBuffer, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.buffer,
+                         1, &region);
+
+  // Back to where the image was for whatever comes next
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.newLayout = layout;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  finish(commandBuffer, frame, target, size, std::move(done));
+}
+
+std::future<std::vector<char>>
+ReadbackQueue::readImage(VkCommandBuffer commandBuffer, uint64_t frame,
+                         VkImage image, VkImageLayout layout,
+                         VkExtent2D extent, uint32_t texelSize) {
+  std::promise<std::vector<char>> promise;
+  std::future<std::vector<char>> future = promise.get_future();
+
+  readImage(commandBuffer, frame, image, layout, extent, texelSize,
+            fulfil(std::move(promise)));
+  return future;
+}
+
+void ReadbackQueue::collect(uint64_t completed) {
+  std::deque<Request> ready;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!requests.empty() && requests.front().frame <= completed) {
+      ready.push_back(std::move(requests.front()));
+      requests.pop_front();
+    }
+  }
+
+  // Outside of the lock, callbacks may queue more readbacks
+  for (Request &request : ready)
+    request.done(request.buffer.memory.mapped, request.size);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (Request &request : ready)
+    pool.push_back(request.buffer);
+}
+
+void ReadbackQueue::flush() { collect(UINT64_MAX); }
+
+size_t ReadbackQueue::pending() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return requests.size();
+}
+
+ReadbackQueue::Buffer ReadbackQueue::acquire(VkDeviceSize size) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto best = pool.end();
+    for (auto it = pool.begin(); it != pool.end(); it++)
+      if (it->size >= size && (best == pool.end() || it->size < best->size))
+        best = it;
+
+    if (best != pool.end()) {
+      Buffer out = *best;
+      pool.erase(best);
+      return out;
+    }
+  }
+
+  // Power-of-two sizes keep buffers reusable across similar requests
+  Buffer out{};
+  out.size = MIN_BUFFER_SIZE;
+  while (out.size < size)
+    out.size <<= 1;
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = out.size;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  allocator->createBuffer(bufferInfo, MemoryUsage::Readback, out.buffer,
+                          out.memory);
+
+  if (!out.memory.mapped)
+    throw std::runtime_error("readback buffer is not host-visible");
+
+  return out;
+}
+
+void ReadbackQueue::finish(VkCommandBuffer commandBuffer, uint64_t frame,
+                           const Buffer &buffer, VkDeviceSize size,
+                           Callback done) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer.buffer;
+  barrier.offset = 0;
+  barrier.size = size;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier,
+                       0, nullptr);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  requests.push_back({frame, buffer, size, std::move(done)});
+}
@@ -0,0 +1,151 @@
+#include <vk/samplers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+bool SamplerCache::Description::operator==(const Description &other) const {
+  return magFilter == other.magFilter && minFilter == other.minFilter &&
+         mipmapMode == other.mipmapMode &&
+         addressModeU == other.addressModeU &&
+         addressModeV == other.addressModeV &&
+         addressModeW == other.addressModeW &&
+         mipLodBias == other.mipLodBias &&
+         maxAnisotropy == other.maxAnisotropy &&
+         compareEnable == other.compareEnable &&
+         compareOp == other.compareOp && minLod == other.minLod &&
+         maxLod == other.maxLod && borderColor == other.borderColor &&
+         unnormalizedCoordinates == other.unnormalizedCoordinates;
+}
+
+size_t SamplerCache::Hash::operator()(const Description &description) const {
+  // FNV-1a over every field (not the struct's bytes, padding is undefined)
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](auto value) {
+    unsigned char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+
+    for (unsigned char byte : bytes)
+      hash = (hash ^ byte) * 1099511628211ull;
+  };
+
+  // (floats equal as values hash the same, -0 is +0)
+  auto mixFloat = [&mix](float value) { mix(value == 0.0f ? 0.0f : value); };
+
+  mix(description.magFilter);
+  mix(description.minFilter);
+  mix(description.mipmapMode);
+  mix(description.addressModeU);
+  mix(description.addressModeV);
+  mix(description.addressModeW);
+  mixFloat(description.mipLodBias);
+  mixFloat(description.maxAnisotropy);
+  mix(description.compareEnable);
+  mix(description.compareOp);
+  mixFloat(description.minLod);
+  mixFloat(description.maxLod);
+  mix(description.borderColor);
+  mix(description.unnormalizedCoordinates);
+
+  return static_cast<size_t>(hash);
+}
+
+SamplerCache::SamplerCache(VkPhysicalDevice physicalDevice, VkDevice device,
+                           bool anisotropy)
+    : device(device) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+  anisotropyLimit =
+      anisotropy ? std::max(properties.limits.maxSamplerAnisotropy, 1.0f)
+                 : 1.0f;
+}
+
+SamplerCache::~SamplerCache() {
+  for (auto &entry : samplers)
+    vkDestroySampler(device, entry.second, nullptr);
+}
+
+SamplerCache::Description SamplerCache::profile(SamplerProfile profile,
+                                                float maxLod) {
+  Description description;
+  description.maxLod = maxLod;
+
+  switch (profile) {
+  case SamplerProfile::Performance:
+    description.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    break;
+
+  case SamplerProfile::Balanced:
+    description.maxAnisotropy = 4.0f;
+    break;
+
+  case SamplerProfile::Quality:
+    description.maxAnisotropy = 16.0f;
+    break;
+  }
+
+  return description;
+}
+
+VkSampler SamplerCache::get(Description description) {
+  // (a NaN never equals itself, it would never be found again)
+  for (float value : {description.mipLodBias, description.maxAnisotropy,
+                      description.minLod, description.maxLod})
+    if (std::isnan(value))
+      throw std::runtime_error("sampler description has a NaN");
+
+  // Descriptions that end up the same on this device share a sampler
+  description.maxAnisotropy =
+      std::min(std::max(description.maxAnisotropy, 1.0f), anisotropyLimit);
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  auto found = samplers.find(description);
+  if (found != samplers.end())
+    return found->second;
+
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = description.magFilter;
+  samplerInfo.minFilter = description.minFilter;
+  samplerInfo.mipmapMode = description.mipmapMode;
+
+  samplerInfo.addressModeU = description.addressModeU;
+  samplerInfo.addressModeV = description.addressModeV;
+  samplerInfo.addressModeW = description.addressModeW;
+
+  samplerInfo.mipLodBias = description.mipLodBias;
+
+  samplerInfo.anisotropyEnable =
+      description.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+  samplerInfo.maxAnisotropy = description.maxAnisotropy;
+
+  samplerInfo.compareEnable = description.compareEnable;
+  samplerInfo.compareOp = description.compareOp;
+
+  samplerInfo.minLod = description.minLod;
+  samplerInfo.maxLod = description.maxLod;
+
+  samplerInfo.borderColor = description.borderColor;
+  samplerInfo.unnormalizedCoordinates = description.unnormalizedCoordinates;
+
+  VkSampler sampler;
+  if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    throw std::runtime_error("failed to create texture sampler");
+
+  samplers.emplace(description, sampler);
+  return sampler;
+}
+
+VkSampler SamplerCache::get(SamplerProfile profile, float maxLod) {
+  return get(SamplerCache::profile(profile, maxLod));
+}
+
+size_t SamplerCache::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return samplers.size();
+}
+
+float SamplerCache::maxAnisotropy() const { return anisotropyLimit; }
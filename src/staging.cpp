@@ -0,0 +1,113 @@
+#include <vk/staging.hpp>
+
+#include <cstring>
+
+StagingRing::StagingRing(VkDevice device, Allocator *allocator,
+                         VkDeviceSize capacity)
+    : device(device), allocator(allocator), capacity(capacity) {
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = capacity;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  allocator->createBuffer(bufferInfo, MemoryUsage::Staging, buffer, memory);
+}
+
+StagingRing::~StagingRing() {
+  wait(serial);
+
+  for (VkFence fence : fences)
+    vkDestroyFence(device, fence, nullptr);
+
+  allocator->destroyBuffer(buffer, memory);
+}
+
+StagingRing::Region StagingRing::allocate(VkDeviceSize size,
+                                          VkDeviceSize alignment) {
+  if (size > capacity)
+    throw std::runtime_error("staging upload is larger than the ring");
+
+  for (;;) {
+    uint64_t offset = (head + alignment - 1) / alignment * alignment;
+
+    // Regions never straddle the end of the buffer
+    if (offset % capacity + size > capacity)
+      offset = (offset / capacity + 1) * capacity;
+
+    if (offset + size - tail <= capacity) {
+      head = offset + size;
+      return {buffer, offset % capacity,
+              static_cast<char *>(memory.mapped) + offset % capacity};
+    }
+
+    // Only regions of the next submission are left, waiting can't help
+    if (inFlight.empty())
+      throw std::runtime_error("staging ring is full, submit pending uploads");
+
+    retire(true);
+  }
+}
+
+StagingRing::Region StagingRing::push(const void *data, VkDeviceSize size,
+                                      VkDeviceSize alignment) {
+  Region region = allocate(size, alignment);
+  memcpy(region.mapped, data, static_cast<size_t>(size));
+  return region;
+}
+
+uint64_t StagingRing::submit(VkQueue queue, const VkSubmitInfo &submitInfo) {
+  VkFence fence;
+  if (fences.empty()) {
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+      throw std::runtime_error("failed to create staging fence");
+  } else {
+    fence = fences.back();
+    fences.pop_back();
+  }
+
+  if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+    fences.push_back(fence);
+    throw std::runtime_error("failed to submit staging commands");
+  }
+
+  inFlight.push_back({++serial, fence, head});
+  return serial;
+}
+
+void StagingRing::wait(uint64_t serial) {
+  while (done < serial && !inFlight.empty())
+    retire(true);
+}
+
+uint64_t StagingRing::submissions() const { return serial; }
+
+VkDeviceSize StagingRing::size() const { return capacity; }
+
+uint64_t StagingRing::completed() {
+  retire(false);
+  return done;
+}
+
+void StagingRing::retire(bool block) {
+  while (!inFlight.empty()) {
+    Submission &s = inFlight.front();
+
+    if (block) {
+      vkWaitForFences(device, 1, &s.fence, VK_TRUE, UINT64_MAX);
+      block = false;
+    } else if (vkGetFenceStatus(device, s.fence) != VK_SUCCESS)
+      break;
+
+    tail = s.end;
+    done = s.serial;
+
+    vkResetFences(device, 1, &s.fence);
+    fences.push_back(s.fence);
+
+    inFlight.pop_front();
+  }
+}
@@ -0,0 +1,281 @@
+#include <vk/streaming.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+TextureStreamer::Source
+TextureStreamer::fromKtx2(std::shared_ptr<Ktx2Texture> texture) {
+  Source source;
+  source.format = texture->format;
+
+  for (const Ktx2Texture::Level &level : texture->levels)
+    source.levels.push_back(
+        {level.data, level.size, level.width, level.height});
+
+  source.owner = texture;
+  return source;
+}
+
+TextureStreamer::TextureStreamer(VkDevice device, Allocator *allocator,
+                                 DeletionQueue *deletions, uint32_t frames,
+                                 VkDeviceSize budget)
+    : device(device), allocator(allocator), deletions(deletions),
+      budget(budget) {
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = budget * frames;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  allocator->createBuffer(bufferInfo, MemoryUsage::Staging, upload,
+                          uploadMemory);
+}
+
+TextureStreamer::~TextureStreamer() {
+  for (Stream &stream : streams)
+    vkDestroyImageView(device, stream.view, nullptr);
+
+  allocator->destroyBuffer(upload, uploadMemory);
+}
+
+uint32_t TextureStreamer::add(VkImage image, Source source,
+                              uint32_t resident) {
+  if (source.levels.empty() || resident >= source.levels.size())
+    throw std::runtime_error("streamed texture has no resident level");
+
+  Stream stream;
+  stream.image = image;
+  stream.source = std::move(source);
+  stream.blockSize = stream.source.format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK &&
+                             stream.source.format <= VK_FORMAT_BC7_SRGB_BLOCK
+                         ? 4
+                         : 1;
+  stream.resident = resident;
+
+  // Every row must fit in a slice (rows are never split)
+  const Level &level = stream.source.levels[0];
+  uint32_t blockRows = (level.height + stream.blockSize - 1) / stream.blockSize;
+  if (level.size / blockRows + 16 > budget)
+    throw std::runtime_error("texture rows exceed the streaming budget");
+
+  stream.view = createView(stream, resident);
+
+  streams.push_back(std::move(stream));
+  return static_cast<uint32_t>(streams.size() - 1);
+}
+
+VkImageView TextureStreamer::view(uint32_t texture) const {
+  return streams[texture].view;
+}
+
+uint32_t TextureStreamer::resident(uint32_t texture) const {
+  return streams[texture].resident;
+}
+
+void TextureStreamer::report(uint32_t texture, float pixels) {
+  Stream &stream = streams[texture];
+  stream.reported = std::max(stream.reported, pixels);
+}
+
+uint32_t TextureStreamer::wanted(const Stream &stream) const {
+  uint32_t levels = static_cast<uint32_t>(stream.source.levels.size());
+  if (stream.pixels <= 0.0f)
+    return levels - 1;
+
+  // Finest level still having more texels than pixels on screen
+  const Level &level = stream.source.levels[0];
+  float texels = static_cast<float>(std::max(level.width, level.height));
+  float lod = std::floor(std::log2(texels / stream.pixels));
+
+  return static_cast<uint32_t>(
+      std::min(std::max(lod, 0.0f), static_cast<float>(levels - 1)));
+}
+
+void TextureStreamer::begin(uint32_t frame, uint64_t serial) {
+  this->frame = frame;
+  this->serial = serial;
+
+  copies.clear();
+  started.clear();
+  completed.clear();
+
+  // The previous frame's draws set the priorities
+  for (Stream &stream : streams) {
+    stream.pixels = stream.reported;
+    stream.reported = 0.0f;
+  }
+
+  char *slice = static_cast<char *>(uploadMemory.mapped) + frame * budget;
+  VkDeviceSize used = 0;
+
+  for (;;) {
+    // Most under-resolved texture (fewest texels per pixel on screen)
+    int32_t next = -1;
+    float error = 0.0f;
+
+    for (uint32_t i = 0; i < streams.size(); i++) {
+      const Stream &stream = streams[i];
+      if (stream.resident <= wanted(stream))
+        continue;
+
+      const Level &level = stream.source.levels[stream.resident];
+      float texels = static_cast<float>(std::max(level.width, level.height));
+
+      if (next < 0 || stream.pixels / texels > error) {
+        next = static_cast<int32_t>(i);
+        error = stream.pixels / texels;
+      }
+    }
+
+    if (next < 0)
+      break;
+
+    Stream &stream = streams[next];
+    uint32_t index = stream.resident - 1;
+    const Level &level = stream.source.levels[index];
+
+    uint32_t blockRows =
+        (level.height + stream.blockSize - 1) / stream.blockSize;
+    size_t rowBytes = level.size / blockRows;
+
+    // (16 byte aligned, a multiple of every texel & block size)
+    VkDeviceSize offset = (used + 15) / 16 * 16;
+    if (offset >= budget)
+      break;
+
+    uint32_t rows = static_cast<uint32_t>(std::min<VkDeviceSize>(
+        blockRows - stream.rowsDone, (budget - offset) / rowBytes));
+    if (rows == 0)
+      break;
+
+    memcpy(slice + offset,
+           static_cast<const char *>(level.data) + stream.rowsDone * rowBytes,
+           rows * rowBytes);
+
+    if (stream.rowsDone == 0)
+      started.push_back({static_cast<uint32_t>(next), index});
+
+    uint32_t firstRow = stream.rowsDone * stream.blockSize;
+    copies.push_back(
+        {static_cast<uint32_t>(next), index, firstRow,
+         std::min(rows * stream.blockSize, level.height - firstRow),
+         frame * budget + offset});
+
+    stream.rowsDone += rows;
+    used = offset + rows * rowBytes;
+
+    if (stream.rowsDone < blockRows)
+      break; // (the slice is full)
+
+    // Level complete, it is sampled from this frame on
+    completed.push_back({static_cast<uint32_t>(next), index});
+
+    VkImageView old = stream.view;
+    VkDevice device = this->device;
+    deletions->push(serial, [device, old]() {
+      vkDestroyImageView(device, old, nullptr);
+    });
+
+    stream.resident = index;
+    stream.rowsDone = 0;
+    stream.view = createView(stream, index);
+  }
+
+  counters.frameBytes = used;
+  counters.uploaded += used;
+}
+
+void TextureStreamer::record(VkCommandBuffer commandBuffer) {
+  if (copies.empty())
+    return;
+
+  auto barrier = [this](std::pair<uint32_t, uint32_t> level) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = streams[level.first].image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level.second, 1, 0,
+                                1};
+    return barrier;
+  };
+
+  // Levels started this frame (their contents were never used)
+  std::vector<VkImageMemoryBarrier> barriers;
+  for (auto level : started) {
+    VkImageMemoryBarrier to = barrier(level);
+    to.srcAccessMask = 0;
+    to.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    to.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    to.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers.push_back(to);
+  }
+
+  if (!barriers.empty())
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+
+  for (const Copy &copy : copies) {
+    const Stream &stream = streams[copy.stream];
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = copy.offset;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, copy.level, 0, 1};
+    region.imageOffset = {0, static_cast<int32_t>(copy.firstRow), 0};
+    region.imageExtent = {stream.source.levels[copy.level].width, copy.rows,
+                          1};
+
+    vkCmdCopyBufferToImage(commandBuffer, upload, stream.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+  }
+
+  // Levels completed this frame (rows copied by earlier frames included)
+  barriers.clear();
+  for (auto level : completed) {
+    VkImageMemoryBarrier to = barrier(level);
+    to.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    to.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    to.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    to.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers.push_back(to);
+  }
+
+  if (!barriers.empty())
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+}
+
+TextureStreamer::Stats TextureStreamer::stats() const {
+  Stats stats = counters;
+  stats.textures = static_cast<uint32_t>(streams.size());
+
+  for (const Stream &stream : streams)
+    if (stream.resident > wanted(stream))
+      stats.streaming++;
+
+  return stats;
+}
+
+VkImageView TextureStreamer::createView(const Stream &stream,
+                                        uint32_t level) {
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = stream.image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = stream.source.format;
+  viewInfo.subresourceRange = {
+      VK_IMAGE_ASPECT_COLOR_BIT, level,
+      static_cast<uint32_t>(stream.source.levels.size()) - level, 0, 1};
+
+  VkImageView view;
+  if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+    throw std::runtime_error("failed to create streamed texture view");
+
+  return view;
+}
@@ -0,0 +1,397 @@
+#include <vk/textures.hpp>
+
+#include <types/jobs.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+// Handle
+
+TextureManager::Handle::Handle(TextureManager *manager, Entry *entry)
+    : manager(manager), entry(entry) {}
+
+TextureManager::Handle::Handle(const Handle &other)
+    : manager(other.manager), entry(other.entry) {
+  if (entry)
+    manager->retain(entry);
+}
+
+TextureManager::Handle::Handle(Handle &&other)
+    : manager(other.manager), entry(other.entry) {
+  other.manager = nullptr;
+  other.entry = nullptr;
+}
+
+TextureManager::Handle &TextureManager::Handle::operator=(Handle other) {
+  std::swap(manager, other.manager);
+  std::swap(entry, other.entry);
+  return *this;
+}
+
+TextureManager::Handle::~Handle() {
+  if (entry)
+    manager->release(entry);
+}
+
+const Texture &TextureManager::Handle::operator*() const {
+  return entry->texture;
+}
+
+const Texture *TextureManager::Handle::operator->() const {
+  return &entry->texture;
+}
+
+TextureManager::Handle::operator bool() const { return entry; }
+
+// Texture Manager
+
+TextureManager::TextureManager(Allocator *allocator, Loader load,
+                               Destroyer destroy, Evictor evict)
+    : allocator(allocator), load(load), destroy(destroy), evict(evict) {}
+
+TextureManager::~TextureManager() {
+  if (counters.handles)
+    fprintf(stderr, "texture manager destroyed with %u live handle(s)\n",
+            counters.handles);
+
+  for (auto &[hash, entry] : byContent) {
+    if (entry->evictable)
+      allocator->removeEvictable(entry->evictable);
+
+    destroy(entry->texture);
+    delete entry;
+  }
+}
+
+TextureManager::Handle TextureManager::handle(Entry *entry) {
+  adopt(entry);
+  return Handle(this, entry);
+}
+
+std::vector<TextureManager::Handle>
+TextureManager::acquire(const std::vector<std::string> &paths) {
+  std::vector<Handle> out(paths.size());
+
+  // Files not resident under their path yet
+  struct File {
+    size_t index;
+    std::string path;
+
+    uint64_t hash = 0, size = 0;
+    bool readable = false;
+
+    // A path of a resident texture with the same contents, if any
+    std::string resident;
+
+    // First file of the batch with the same contents (itself if none) & the
+    // load it waits for
+    size_t first;
+    size_t pending = SIZE_MAX;
+  };
+  std::vector<File> files;
+  std::vector<std::string> canonical(paths.size());
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    std::error_code error;
+    canonical[i] = std::filesystem::weakly_canonical(paths[i], error).string();
+    if (error)
+      canonical[i] = paths[i];
+
+    auto known = byPath.find(canonical[i]);
+    if (known != byPath.end()) {
+      counters.pathHits++;
+      counters.saved += known->second->texture.memory.size;
+      out[i] = handle(known->second);
+      continue;
+    }
+
+    File file;
+    file.index = i;
+    file.path = canonical[i];
+    file.first = files.size();
+    files.push_back(file);
+  }
+
+  if (files.empty())
+    return out;
+
+  // Fingerprinted on every thread without the lock, files may be large
+  lock.unlock();
+  parallelFor(files.size(), [&](size_t begin, size_t end) {
+    for (size_t f = begin; f < end; f++)
+      files[f].readable = hashFile(files[f].path, files[f].hash, files[f].size);
+  });
+  lock.lock();
+
+  // Resident textures that may have the same contents
+  std::vector<std::vector<std::string>> candidates(files.size());
+  for (size_t f = 0; f < files.size(); f++) {
+    auto [same, end] = byContent.equal_range(files[f].hash);
+    for (; files[f].readable && same != end; same++)
+      if (same->second->size == files[f].size &&
+          !same->second->paths.empty())
+        candidates[f].push_back(same->second->paths.front());
+  }
+
+  // Fingerprints only narrow things down, matches are compared in full
+  lock.unlock();
+  parallelFor(files.size(), [&](size_t begin, size_t end) {
+    for (size_t f = begin; f < end; f++) {
+      File &file = files[f];
+      if (!file.readable)
+        continue;
+
+      for (const std::string &candidate : candidates[f])
+        if (sameContents(candidate, file.path)) {
+          file.resident = candidate;
+          break;
+        }
+
+      if (!file.resident.empty())
+        continue;
+
+      for (size_t e = 0; e < f; e++) {
+        const File &earlier = files[e];
+        if (earlier.readable &&
+            (earlier.path == file.path ||
+             (earlier.hash == file.hash && earlier.size == file.size &&
+              sameContents(earlier.path, file.path)))) {
+          file.first = e;
+          break;
+        }
+      }
+    }
+  });
+  lock.lock();
+
+  // Files to load & the handles waiting for each of them
+  std::vector<std::string> missing;
+  std::vector<std::vector<size_t>> waiting;
+  std::vector<Entry *> entries(files.size(), nullptr);
+
+  for (size_t f = 0; f < files.size(); f++) {
+    File &file = files[f];
+    if (!file.readable)
+      continue;
+
+    // Loaded under this path by someone else meanwhile
+    auto known = byPath.find(file.path);
+    if (known != byPath.end()) {
+      counters.pathHits++;
+      entries[f] = known->second;
+    } else if (!file.resident.empty() && byPath.count(file.resident)) {
+      counters.contentHits++;
+      entries[f] = byPath[file.resident];
+    } else if (file.first != f) {
+      // Repeated within this batch (by path or contents)
+      const File &first = files[file.first];
+      if (first.path == file.path)
+        counters.pathHits++;
+      else
+        counters.contentHits++;
+
+      entries[f] = entries[file.first];
+      file.pending = first.pending;
+    }
+
+    if (entries[f]) {
+      counters.saved += entries[f]->texture.memory.size;
+      alias(entries[f], file.path);
+      out[file.index] = handle(entries[f]);
+      continue;
+    }
+
+    if (file.pending == SIZE_MAX) {
+      file.pending = missing.size();
+      missing.push_back(file.path);
+      waiting.emplace_back();
+    }
+
+    waiting[file.pending].push_back(f);
+  }
+
+  if (missing.empty())
+    return out;
+
+  // Upload everything new at once
+  lock.unlock();
+  std::vector<Texture> textures = load(missing);
+  lock.lock();
+
+  for (size_t m = 0; m < missing.size(); m++) {
+    if (!textures[m].image)
+      continue;
+
+    Entry *entry;
+    const File &first = files[waiting[m].front()];
+
+    // Someone else loaded the same path meanwhile, drop this copy
+    auto known = byPath.find(first.path);
+    if (known != byPath.end()) {
+      destroy(textures[m]);
+      counters.pathHits++;
+      entry = known->second;
+    } else {
+      entry = new Entry{textures[m], first.hash, first.size};
+      byContent.emplace(entry->hash, entry);
+
+      counters.textures++;
+      counters.resident += entry->texture.memory.size;
+    }
+
+    // Every path of the batch with these contents leads to it from now on
+    for (size_t f : waiting[m]) {
+      alias(entry, files[f].path);
+      out[files[f].index] = handle(entry);
+    }
+
+    // Later handles in the batch shared the upload
+    counters.saved += (waiting[m].size() - 1) * entry->texture.memory.size;
+  }
+
+  return out;
+}
+
+TextureManager::Handle TextureManager::acquire(const std::string &path) {
+  return std::move(acquire(std::vector<std::string>{path})[0]);
+}
+
+TextureManager::Stats TextureManager::stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return counters;
+}
+
+void TextureManager::retain(Entry *entry) {
+  std::lock_guard<std::mutex> lock(mutex);
+  adopt(entry);
+}
+
+void TextureManager::alias(Entry *entry, const std::string &path) {
+  if (byPath.emplace(path, entry).second)
+    entry->paths.push_back(path);
+}
+
+void TextureManager::adopt(Entry *entry) {
+  // Back in use, no longer evictable
+  if (entry->evictable) {
+    allocator->removeEvictable(entry->evictable);
+    cached.erase(entry->cacheKey);
+
+    entry->evictable = 0;
+    entry->cacheKey = 0;
+    counters.cached--;
+  }
+
+  entry->references++;
+  counters.handles++;
+}
+
+void TextureManager::release(Entry *entry) {
+  std::lock_guard<std::mutex> lock(mutex);
+  counters.handles--;
+
+  if (--entry->references)
+    return;
+
+  // Last reference gone, keep it until memory runs short (its last use is
+  // the current frame, so it isn't evicted before that has finished)
+  uint64_t key = nextCacheKey++;
+  entry->cacheKey = key;
+  entry->evictable = allocator->addEvictable(entry->texture.memory,
+                                             [this, key]() { evicted(key); });
+
+  cached[key] = entry;
+  counters.cached++;
+}
+
+void TextureManager::remove(Entry *entry, const Destroyer &destroyer) {
+  for (const std::string &path : entry->paths)
+    byPath.erase(path);
+
+  auto [same, end] = byContent.equal_range(entry->hash);
+  while (same->second != entry)
+    same++;
+  byContent.erase(same);
+
+  counters.textures--;
+  counters.resident -= entry->texture.memory.size;
+
+  destroyer(entry->texture);
+  delete entry;
+}
+
+void TextureManager::evicted(uint64_t cacheKey) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Acquired again after the allocator picked it, keep it
+  auto entry = cached.find(cacheKey);
+  if (entry == cached.end())
+    return;
+
+  Entry *victim = entry->second;
+  cached.erase(entry);
+  counters.cached--;
+  counters.evicted++;
+
+  remove(victim, evict);
+}
+
+bool TextureManager::hashFile(const std::string &path, uint64_t &hash,
+                              uint64_t &size) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+
+  hash = 0xcbf29ce484222325;
+  size = 0;
+
+  // A word at a time (trailing bytes padded with zeros, the size tells)
+  uint64_t buffer[8 * 1024];
+  for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+    size_t words = (read + 7) / 8;
+    if (read % 8)
+      memset(reinterpret_cast<char *>(buffer) + read, 0, 8 - read % 8);
+
+    for (size_t i = 0; i < words; i++) {
+      hash = (hash ^ buffer[i]) * 0x9e3779b97f4a7c15;
+      hash ^= hash >> 32;
+    }
+
+    size += read;
+  }
+
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+bool TextureManager::sameContents(const std::string &a, const std::string &b) {
+  FILE *fileA = fopen(a.c_str(), "rb");
+  FILE *fileB = fopen(b.c_str(), "rb");
+
+  bool same = fileA && fileB;
+  std::vector<char> bufferA(64 * 1024), bufferB(64 * 1024);
+
+  while (same) {
+    size_t readA = fread(bufferA.data(), 1, bufferA.size(), fileA);
+    size_t readB = fread(bufferB.data(), 1, bufferB.size(), fileB);
+
+    same = readA == readB && !memcmp(bufferA.data(), bufferB.data(), readA);
+    if (!readA)
+      break;
+  }
+
+  same = same && !ferror(fileA) && !ferror(fileB);
+
+  if (fileA)
+    fclose(fileA);
+  if (fileB)
+    fclose(fileB);
+
+  return same;
+}
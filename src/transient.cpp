@@ -0,0 +1,113 @@
+#include <vk/transient.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+TransientPool::TransientPool(VkDevice device, Allocator *allocator)
+    : device(device), allocator(allocator) {}
+
+TransientPool::~TransientPool() {
+  for (Attachment &attachment : attachments)
+    vkDestroyImage(device, attachment.image, nullptr);
+
+  for (Slot &slot : slots)
+    allocator->free(slot.memory);
+}
+
+VkImage TransientPool::add(const VkImageCreateInfo &imageInfo,
+                           uint32_t firstPass, uint32_t lastPass) {
+  if (built)
+    throw std::runtime_error("transient pool is already built");
+
+  Attachment attachment{};
+  attachment.firstPass = firstPass;
+  attachment.lastPass = lastPass;
+
+  if (vkCreateImage(device, &imageInfo, nullptr, &attachment.image) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create transient image");
+
+  vkGetImageMemoryRequirements(device, attachment.image,
+                               &attachment.requirements);
+
+  attachments.push_back(attachment);
+  return attachment.image;
+}
+
+void TransientPool::build() {
+  // Largest attachments first, so smaller ones fit into their slots
+  std::vector<uint32_t> order(attachments.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return attachments[a].requirements.size > attachments[b].requirements.size;
+  });
+
+  for (uint32_t index : order) {
+    const Attachment &attachment = attachments[index];
+    const VkMemoryRequirements &requirements = attachment.requirements;
+
+    // First slot with a common memory type that is free during its passes
+    Slot *target = nullptr;
+    for (Slot &slot : slots)
+      if (slot.requirements.memoryTypeBits & requirements.memoryTypeBits &&
+          !overlaps(slot, attachment)) {
+        target = &slot;
+        break;
+      }
+
+    if (!target) {
+      slots.push_back({requirements, {}, {}});
+      target = &slots.back();
+    }
+
+    VkMemoryRequirements &shared = target->requirements;
+    shared.size = std::max(shared.size, requirements.size);
+    shared.alignment = std::max(shared.alignment, requirements.alignment);
+    shared.memoryTypeBits &= requirements.memoryTypeBits;
+
+    target->attachments.push_back(index);
+  }
+
+  for (Slot &slot : slots) {
+    slot.memory =
+        allocator->allocate(slot.requirements, MemoryUsage::Transient, false);
+
+    for (uint32_t index : slot.attachments)
+      vkBindImageMemory(device, attachments[index].image, slot.memory.memory,
+                        slot.memory.offset);
+  }
+
+  built = true;
+}
+
+TransientPool::Report TransientPool::report() const {
+  Report out;
+  out.attachments = attachments.size();
+  out.allocations = slots.size();
+
+  for (const Attachment &attachment : attachments)
+    out.dedicated += attachment.requirements.size;
+
+  for (const Slot &slot : slots) {
+    out.allocated += slot.requirements.size;
+
+    if (slot.memory.memory &&
+        allocator->memoryProperties(slot.memory.memoryType) &
+            VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+      out.lazy++;
+  }
+
+  return out;
+}
+
+bool TransientPool::overlaps(const Slot &slot,
+                             const Attachment &attachment) const {
+  for (uint32_t index : slot.attachments) {
+    const Attachment &other = attachments[index];
+    if (attachment.firstPass <= other.lastPass &&
+        other.firstPass <= attachment.lastPass)
+      return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,194 @@
+#include <types/atlas.hpp>
+#include <types/jobs.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+static uint32_t roundUp(uint32_t value, uint32_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Copy an image into a rectangle of a layer, repeating its edge texels
+// outside of it (the image sits at x, y inside the rectangle)
+static void fill(Image &layer, const Image &image, uint32_t left,
+                 uint32_t top, uint32_t width, uint32_t height, uint32_t x,
+                 uint32_t y) {
+  for (uint32_t row = 0; row < height; row++) {
+    uint32_t srcRow = std::min(
+        static_cast<uint32_t>(std::max<int64_t>(int64_t(row) - y, 0)),
+        image.height - 1);
+
+    const uint8_t *src = &image.pixels[size_t(srcRow) * image.width * 4];
+    uint8_t *dst =
+        &layer.pixels[(size_t(top + row) * layer.width + left) * 4];
+
+    // Left gutter, the row itself & the right gutter
+    for (uint32_t col = 0; col < x; col++)
+      memcpy(dst + col * 4, src, 4);
+
+    memcpy(dst + x * 4, src, size_t(image.width) * 4);
+
+    for (uint32_t col = x + image.width; col < width; col++)
+      memcpy(dst + col * 4, src + size_t(image.width - 1) * 4, 4);
+  }
+}
+
+vec<2> TextureAtlas::Region::remap(vec<2> uv) const {
+  return vec<2>(offset[0] + std::clamp(uv[0], 0.0f, 1.0f) * scale[0],
+                offset[1] + std::clamp(uv[1], 0.0f, 1.0f) * scale[1]);
+}
+
+TextureAtlas TextureAtlas::pack(const std::vector<Image> &images, bool srgb,
+                                Mode mode, uint32_t size, uint32_t padding) {
+  if (padding == 0 || (padding & (padding - 1)))
+    throw std::runtime_error("atlas padding must be a power of two");
+
+  TextureAtlas atlas;
+  if (images.empty())
+    return atlas;
+
+  for (const Image &image : images)
+    if (!image.width || !image.height ||
+        image.pixels.size() < size_t(image.width) * image.height * 4)
+      throw std::runtime_error("atlas image has no pixels");
+
+  // Cell of each image (the region with its gutter)
+  struct Cell {
+    uint32_t layer;
+    uint32_t x, y;
+    uint32_t width, height;
+  };
+  std::vector<Cell> cells(images.size());
+
+  if (mode == Mode::Array) {
+    for (size_t i = 0; i < images.size(); i++) {
+      atlas.width = std::max(atlas.width, images[i].width);
+      atlas.height = std::max(atlas.height, images[i].height);
+    }
+
+    for (size_t i = 0; i < images.size(); i++)
+      cells[i] = {static_cast<uint32_t>(i), 0, 0, atlas.width, atlas.height};
+
+    atlas.mipLevels = Image::fullMipLevels(atlas.width, atlas.height);
+    atlas.layers.resize(images.size());
+  } else {
+    // Shelves are filled tallest images first
+    std::vector<size_t> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    for (size_t i = 0; i < images.size(); i++) {
+      cells[i].width = roundUp(images[i].width + 2 * padding, padding);
+      cells[i].height = roundUp(images[i].height + 2 * padding, padding);
+
+      if (cells[i].width > size || cells[i].height > size)
+        throw std::runtime_error("image does not fit in an atlas layer");
+    }
+
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return cells[a].height != cells[b].height
+                 ? cells[a].height > cells[b].height
+                 : cells[a].width > cells[b].width;
+    });
+
+    struct Shelf {
+      uint32_t layer;
+      uint32_t y, height;
+      uint32_t used;
+    };
+    std::vector<Shelf> shelves;
+    std::vector<uint32_t> bottoms;
+
+    for (size_t i : order) {
+      Cell &cell = cells[i];
+
+      // First shelf with room left, else a new one (on a new layer if full)
+      auto shelf = std::find_if(
+          shelves.begin(), shelves.end(), [&](const Shelf &shelf) {
+            return shelf.height >= cell.height &&
+                   shelf.used + cell.width <= size;
+          });
+
+      if (shelf == shelves.end()) {
+        if (bottoms.empty() || bottoms.back() + cell.height > size)
+          bottoms.push_back(0);
+
+        uint32_t layer = static_cast<uint32_t>(bottoms.size() - 1);
+        shelves.push_back({layer, bottoms.back(), cell.height, 0});
+        bottoms.back() += cell.height;
+
+        shelf = shelves.end() - 1;
+      }
+
+      cell.layer = shelf->layer;
+      cell.x = shelf->used;
+      cell.y = shelf->y;
+      shelf->used += cell.width;
+
+      atlas.width = std::max(atlas.width, shelf->used);
+      atlas.height = std::max(atlas.height, shelf->y + shelf->height);
+    }
+
+    // Cells stay apart down to the level where a gutter is one texel
+    uint32_t levels = 1;
+    for (uint32_t p = padding; p > 1; p >>= 1)
+      levels++;
+
+    atlas.mipLevels =
+        std::min(levels, Image::fullMipLevels(atlas.width, atlas.height));
+    atlas.layers.resize(bottoms.size());
+  }
+
+  atlas.regions.resize(images.size());
+  for (size_t i = 0; i < images.size(); i++) {
+    const Cell &cell = cells[i];
+    uint32_t gutter = mode == Mode::Array ? 0 : padding;
+
+    Region &region = atlas.regions[i];
+    region.layer = cell.layer;
+    region.x = cell.x + gutter;
+    region.y = cell.y + gutter;
+    region.width = images[i].width;
+    region.height = images[i].height;
+
+    region.offset = vec<2>(static_cast<float>(region.x) / atlas.width,
+                           static_cast<float>(region.y) / atlas.height);
+    region.scale = vec<2>(static_cast<float>(region.width) / atlas.width,
+                          static_cast<float>(region.height) / atlas.height);
+  }
+
+  // Build every layer & its chain on its own thread
+  parallelFor(atlas.layers.size(), [&](size_t begin, size_t end) {
+    for (size_t l = begin; l < end; l++) {
+      Image &layer = atlas.layers[l];
+      layer.width = atlas.width;
+      layer.height = atlas.height;
+      layer.mipLevels = atlas.mipLevels;
+      layer.pixels.assign(layer.levelOffset(layer.mipLevels), 0);
+
+      for (size_t i = 0; i < images.size(); i++) {
+        const Cell &cell = cells[i];
+        const Region &region = atlas.regions[i];
+
+        if (cell.layer == l)
+          fill(layer, images[i], cell.x, cell.y, cell.width, cell.height,
+               region.x - cell.x, region.y - cell.y);
+      }
+
+      for (uint32_t level = 1; level < layer.mipLevels; level++)
+        Image::downsample(&layer.pixels[layer.levelOffset(level - 1)],
+                          layer.levelWidth(level - 1),
+                          layer.levelHeight(level - 1),
+                          &layer.pixels[layer.levelOffset(level)], srgb);
+    }
+  });
+
+  return atlas;
+}
+
+void TextureAtlas::remap(std::vector<Vertex> &vertices,
+                         const Region &region) {
+  for (Vertex &vertex : vertices)
+    vertex.texCoord = region.remap(vertex.texCoord);
+}
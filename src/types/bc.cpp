@@ -0,0 +1,420 @@
+#include <types/bc.hpp>
+#include <types/jobs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// BC7 4-bit index interpolation weights (out of 64)
+static const int WEIGHTS4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Best-Fit Line through N-channel texels
+// (principal axis by power iteration, endpoints at the extreme projections)
+template <int N>
+static void fitLine(const float texels[16][4], float low[4], float high[4]) {
+  float mean[N] = {}, minimum[N], maximum[N];
+  std::fill(minimum, minimum + N, 255.0f);
+  std::fill(maximum, maximum + N, 0.0f);
+
+  for (int i = 0; i < 16; i++)
+    for (int c = 0; c < N; c++) {
+      mean[c] += texels[i][c] / 16.0f;
+      minimum[c] = std::min(minimum[c], texels[i][c]);
+      maximum[c] = std::max(maximum[c], texels[i][c]);
+    }
+
+  float covariance[N][N] = {};
+  for (int i = 0; i < 16; i++)
+    for (int a = 0; a < N; a++)
+      for (int b = 0; b < N; b++)
+        covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+
+  // Start from the bounding box diagonal
+  float axis[N];
+  for (int c = 0; c < N; c++)
+    axis[c] = maximum[c] - minimum[c];
+
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[N] = {}, length = 0.0f;
+    for (int a = 0; a < N; a++) {
+      for (int b = 0; b < N; b++)
+        next[a] += covariance[a][b] * axis[b];
+      length += next[a] * next[a];
+    }
+
+    if (length < 1e-12f)
+      break;
+
+    length = 1.0f / std::sqrt(length);
+    for (int c = 0; c < N; c++)
+      axis[c] = next[c] * length;
+  }
+
+  float length = 0.0f;
+  for (int c = 0; c < N; c++)
+    length += axis[c] * axis[c];
+
+  // Flat block
+  if (length < 1e-12f) {
+    std::copy(mean, mean + N, low);
+    std::copy(mean, mean + N, high);
+    return;
+  }
+
+  length = 1.0f / std::sqrt(length);
+  for (int c = 0; c < N; c++)
+    axis[c] *= length;
+
+  float tMin = 0.0f, tMax = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for (int c = 0; c < N; c++)
+      t += (texels[i][c] - mean[c]) * axis[c];
+    tMin = std::min(tMin, t);
+    tMax = std::max(tMax, t);
+  }
+
+  for (int c = 0; c < N; c++) {
+    low[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+    high[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+  }
+}
+
+static void toFloat(const uint8_t *texels, float out[16][4]) {
+  for (int i = 0; i < 16; i++)
+    for (int c = 0; c < 4; c++)
+      out[i][c] = texels[i * 4 + c];
+}
+
+// BC1 Colour (RGB 5:6:5 endpoints, 2-bit indices)
+
+static uint16_t pack565(const float *c) {
+  int r = static_cast<int>(c[0] * 31.0f / 255.0f + 0.5f);
+  int g = static_cast<int>(c[1] * 63.0f / 255.0f + 0.5f);
+  int b = static_cast<int>(c[2] * 31.0f / 255.0f + 0.5f);
+  return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+static void unpack565(uint16_t v, int *c) {
+  int r = v >> 11 & 31, g = v >> 5 & 63, b = v & 31;
+  c[0] = r << 3 | r >> 2;
+  c[1] = g << 2 | g >> 4;
+  c[2] = b << 3 | b >> 2;
+}
+
+void CompressedImage::encodeBC1(const uint8_t *texels, uint8_t *block) {
+  float colours[16][4];
+  toFloat(texels, colours);
+
+  float low[4], high[4];
+  fitLine<3>(colours, low, high);
+
+  // c0 > c1 selects four colours (equal endpoints only use index 0)
+  uint16_t c0 = pack565(high), c1 = pack565(low);
+  if (c0 < c1)
+    std::swap(c0, c1);
+
+  int palette[4][3];
+  unpack565(c0, palette[0]);
+  unpack565(c1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+
+  uint32_t indices = 0;
+  if (c0 != c1)
+    for (int i = 0; i < 16; i++) {
+      int best = 0, bestError = INT32_MAX;
+      for (int p = 0; p < 4; p++) {
+        int error = 0;
+        for (int c = 0; c < 3; c++) {
+          int d = texels[i * 4 + c] - palette[p][c];
+          error += d * d;
+        }
+        if (error < bestError) {
+          bestError = error;
+          best = p;
+        }
+      }
+      indices |= static_cast<uint32_t>(best) << (2 * i);
+    }
+
+  block[0] = c0 & 0xff;
+  block[1] = c0 >> 8;
+  block[2] = c1 & 0xff;
+  block[3] = c1 >> 8;
+  for (int b = 0; b < 4; b++)
+    block[4 + b] = indices >> (8 * b) & 0xff;
+}
+
+// BC4 Channel (8-bit endpoints, 3-bit indices)
+static void encodeBC4(const uint8_t *texels, int channel, uint8_t *block) {
+  int low = 255, high = 0;
+  for (int i = 0; i < 16; i++) {
+    low = std::min<int>(low, texels[i * 4 + channel]);
+    high = std::max<int>(high, texels[i * 4 + channel]);
+  }
+
+  // high > low selects six interpolated values
+  block[0] = high;
+  block[1] = low;
+
+  uint64_t indices = 0;
+  if (high != low) {
+    int palette[8] = {high, low};
+    for (int p = 2; p < 8; p++)
+      palette[p] = ((8 - p) * high + (p - 1) * low) / 7;
+
+    for (int i = 0; i < 16; i++) {
+      int best = 0, bestError = INT32_MAX;
+      for (int p = 0; p < 8; p++) {
+        int error = std::abs(texels[i * 4 + channel] - palette[p]);
+        if (error < bestError) {
+          bestError = error;
+          best = p;
+        }
+      }
+      indices |= static_cast<uint64_t>(best) << (3 * i);
+    }
+  }
+
+  for (int b = 0; b < 6; b++)
+    block[2 + b] = indices >> (8 * b) & 0xff;
+}
+
+void CompressedImage::encodeBC3(const uint8_t *texels, uint8_t *block) {
+  encodeBC4(texels, 3, block);
+  encodeBC1(texels, block + 8);
+}
+
+void CompressedImage::encodeBC5(const uint8_t *texels, uint8_t *block) {
+  encodeBC4(texels, 0, block);
+  encodeBC4(texels, 1, block + 8);
+}
+
+// BC7 Mode 6 (one subset, RGBA 7-bit endpoints & p-bits, 4-bit indices)
+
+struct Mode6 {
+  int endpoints[2][4]; // 7 bits
+  int pbits[2];
+  uint8_t indices[16];
+  float error;
+};
+
+// Quantize an endpoint (p-bit shared by its channels)
+static void quantizeMode6(const float *v, int *q, int &pbit) {
+  float bestError = 1e30f;
+
+  for (int p = 0; p < 2; p++) {
+    int candidate[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      candidate[c] =
+          std::clamp(static_cast<int>((v[c] - p) / 2.0f + 0.5f), 0, 127);
+      float d = (candidate[c] << 1 | p) - v[c];
+      error += d * d;
+    }
+
+    if (error < bestError) {
+      bestError = error;
+      pbit = p;
+      std::copy(candidate, candidate + 4, q);
+    }
+  }
+}
+
+// Pick the closest palette entry per texel (returns the total error)
+static float selectMode6(const float texels[16][4], Mode6 &mode) {
+  int palette[16][4];
+  for (int c = 0; c < 4; c++) {
+    int e0 = mode.endpoints[0][c] << 1 | mode.pbits[0];
+    int e1 = mode.endpoints[1][c] << 1 | mode.pbits[1];
+    for (int w = 0; w < 16; w++)
+      palette[w][c] = ((64 - WEIGHTS4[w]) * e0 + WEIGHTS4[w] * e1 + 32) >> 6;
+  }
+
+  mode.error = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    float bestError = 1e30f;
+    for (int w = 0; w < 16; w++) {
+      float error = 0.0f;
+      for (int c = 0; c < 4; c++) {
+        float d = texels[i][c] - palette[w][c];
+        error += d * d;
+      }
+      if (error < bestError) {
+        bestError = error;
+        mode.indices[i] = w;
+      }
+    }
+    mode.error += bestError;
+  }
+
+  return mode.error;
+}
+
+static void fitMode6(const float texels[16][4], const float *low,
+                     const float *high, Mode6 &mode) {
+  quantizeMode6(low, mode.endpoints[0], mode.pbits[0]);
+  quantizeMode6(high, mode.endpoints[1], mode.pbits[1]);
+  selectMode6(texels, mode);
+}
+
+void CompressedImage::encodeBC7(const uint8_t *texels, uint8_t *block) {
+  float colours[16][4];
+  toFloat(texels, colours);
+
+  float low[4], high[4];
+  fitLine<4>(colours, low, high);
+
+  Mode6 best;
+  fitMode6(colours, low, high, best);
+
+  // Refine the endpoints by least squares over the chosen weights
+  float a = 0.0f, b = 0.0f, c = 0.0f, x0[4] = {}, x1[4] = {};
+  for (int i = 0; i < 16; i++) {
+    float w = WEIGHTS4[best.indices[i]] / 64.0f;
+    a += (1.0f - w) * (1.0f - w);
+    b += (1.0f - w) * w;
+    c += w * w;
+    for (int k = 0; k < 4; k++) {
+      x0[k] += (1.0f - w) * colours[i][k];
+      x1[k] += w * colours[i][k];
+    }
+  }
+
+  float determinant = a * c - b * b;
+  if (std::abs(determinant) > 1e-6f) {
+    for (int k = 0; k < 4; k++) {
+      low[k] = std::clamp((c * x0[k] - b * x1[k]) / determinant, 0.0f, 255.0f);
+      high[k] =
+          std::clamp((a * x1[k] - b * x0[k]) / determinant, 0.0f, 255.0f);
+    }
+
+    Mode6 refined;
+    fitMode6(colours, low, high, refined);
+    if (refined.error < best.error)
+      best = refined;
+  }
+
+  // The first index is stored without its top bit, so it must be below 8
+  if (best.indices[0] >= 8) {
+    std::swap(best.endpoints[0], best.endpoints[1]);
+    std::swap(best.pbits[0], best.pbits[1]);
+    for (uint8_t &index : best.indices)
+      index = 15 - index;
+  }
+
+  memset(block, 0, 16);
+
+  uint32_t position = 0;
+  auto put = [&](uint32_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; i++, position++)
+      block[position >> 3] |= (value >> i & 1) << (position & 7);
+  };
+
+  put(1 << 6, 7);
+  for (int k = 0; k < 4; k++) {
+    put(best.endpoints[0][k], 7);
+    put(best.endpoints[1][k], 7);
+  }
+  put(best.pbits[0], 1);
+  put(best.pbits[1], 1);
+
+  put(best.indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    put(best.indices[i], 4);
+}
+
+// Compressed Image
+
+CompressedImage CompressedImage::encode(const Image &image,
+                                        BlockFormat format) {
+  CompressedImage out;
+  out.format = format;
+  out.width = image.width;
+  out.height = image.height;
+  out.mipLevels = image.mipLevels;
+  out.data.resize(out.levelOffset(out.mipLevels));
+
+  void (*encodeBlock)(const uint8_t *, uint8_t *) = nullptr;
+  switch (format) {
+  case BlockFormat::BC1:
+    encodeBlock = encodeBC1;
+    break;
+  case BlockFormat::BC3:
+    encodeBlock = encodeBC3;
+    break;
+  case BlockFormat::BC5:
+    encodeBlock = encodeBC5;
+    break;
+  case BlockFormat::BC7:
+    encodeBlock = encodeBC7;
+    break;
+  }
+
+  // Block rows of every level, so small levels don't serialize the work
+  std::vector<std::pair<uint32_t, uint32_t>> rows;
+  for (uint32_t level = 0; level < out.mipLevels; level++)
+    for (uint32_t y = 0; y < (out.levelHeight(level) + 3) / 4; y++)
+      rows.push_back({level, y});
+
+  uint32_t bytes = blockSize(format);
+
+  parallelFor(rows.size(), [&](size_t begin, size_t end) {
+    uint8_t texels[64];
+
+    for (size_t r = begin; r < end; r++) {
+      auto [level, y] = rows[r];
+
+      uint32_t width = image.levelWidth(level);
+      uint32_t height = image.levelHeight(level);
+      uint32_t blocksX = (width + 3) / 4;
+
+      const uint8_t *src = &image.pixels[image.levelOffset(level)];
+      uint8_t *dst = &out.data[out.levelOffset(level) + y * blocksX * bytes];
+
+      for (uint32_t x = 0; x < blocksX; x++, dst += bytes) {
+        // Edge blocks repeat the last row / column
+        for (uint32_t ty = 0; ty < 4; ty++)
+          for (uint32_t tx = 0; tx < 4; tx++) {
+            uint32_t sx = std::min(x * 4 + tx, width - 1);
+            uint32_t sy = std::min(y * 4 + ty, height - 1);
+            memcpy(texels + (ty * 4 + tx) * 4,
+                   src + (size_t(sy) * width + sx) * 4, 4);
+          }
+
+        encodeBlock(texels, dst);
+      }
+    }
+  });
+
+  return out;
+}
+
+uint32_t CompressedImage::blockSize(BlockFormat format) {
+  return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+uint32_t CompressedImage::levelWidth(uint32_t level) const {
+  return std::max(width >> level, 1u);
+}
+
+uint32_t CompressedImage::levelHeight(uint32_t level) const {
+  return std::max(height >> level, 1u);
+}
+
+size_t CompressedImage::levelOffset(uint32_t level) const {
+  size_t offset = 0;
+  for (uint32_t i = 0; i < level; i++)
+    offset += levelSize(i);
+  return offset;
+}
+
+size_t CompressedImage::levelSize(uint32_t level) const {
+  return size_t((levelWidth(level) + 3) / 4) * ((levelHeight(level) + 3) / 4) *
+         blockSize(format);
+}
@@ -0,0 +1,140 @@
+#include <types/decode.hpp>
+#include <types/jobs.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+
+// Float to half float (round to nearest even, clamped to the half range)
+static uint16_t toHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign = (bits >> 16) & 0x8000;
+  int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // NaN stays NaN, infinity & overflow become the largest half
+  if (((bits >> 23) & 0xff) == 0xff)
+    return uint16_t(sign | (mantissa ? 0x7e00 : 0x7bff));
+  if (exponent >= 31)
+    return uint16_t(sign | 0x7bff);
+
+  // Subnormal halves (or zero)
+  if (exponent <= 0) {
+    if (exponent < -10)
+      return uint16_t(sign);
+
+    mantissa |= 0x800000;
+    uint32_t shift = uint32_t(14 - exponent);
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t midway = 1u << (shift - 1);
+
+    if (rest > midway || (rest == midway && (half & 1)))
+      half++;
+    return uint16_t(sign | half);
+  }
+
+  uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13);
+  uint32_t rest = mantissa & 0x1fff;
+
+  // (a carry into the exponent is still the right value)
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+  return uint16_t(sign | std::min(half, 0x7bffu));
+}
+
+size_t ImageDecoder::bytesPerPixel(Format format) {
+  switch (format) {
+  case Format::R8:
+    return 1;
+  case Format::RG8:
+    return 2;
+  case Format::RGBA8:
+    return 4;
+  case Format::RGBA16F:
+    return 8;
+  }
+  return 4;
+}
+
+bool ImageDecoder::probe(Job &job) {
+  int width, height, channels;
+  job.valid = stbi_info(job.path.c_str(), &width, &height, &channels) &&
+              width > 0 && height > 0;
+
+  job.width = job.valid ? width : 0;
+  job.height = job.valid ? height : 0;
+
+  job.format = Format::RGBA8;
+  if (job.valid && !job.expand) {
+    if (stbi_is_hdr(job.path.c_str()))
+      job.format = Format::RGBA16F;
+    else if (channels == 1)
+      job.format = Format::R8;
+    else if (channels == 2)
+      job.format = Format::RG8;
+  }
+
+  return job.valid;
+}
+
+bool ImageDecoder::decode(Job &job) {
+  job.decoded = false;
+  if (!job.valid || !job.dst)
+    return false;
+
+  // stb_image always allocates its output, which is still in cache when it
+  // is streamed into the destination
+  int width, height, channels;
+  void *pixels;
+
+  if (job.format == Format::RGBA16F)
+    pixels = stbi_loadf(job.path.c_str(), &width, &height, &channels,
+                        STBI_rgb_alpha);
+  else
+    pixels = stbi_load(job.path.c_str(), &width, &height, &channels,
+                       int(bytesPerPixel(job.format)));
+
+  if (!pixels)
+    return false;
+
+  if (uint32_t(width) == job.width && uint32_t(height) == job.height) {
+    if (job.format == Format::RGBA16F) {
+      const float *src = static_cast<const float *>(pixels);
+      uint16_t *dst = static_cast<uint16_t *>(job.dst);
+
+      for (size_t i = 0, count = size_t(width) * height * 4; i < count; i++)
+        dst[i] = toHalf(src[i]);
+    } else
+      memcpy(job.dst, pixels, job.size());
+
+    job.decoded = true;
+  }
+
+  stbi_image_free(pixels);
+  return job.decoded;
+}
+
+void ImageDecoder::probe(std::vector<Job> &jobs, size_t threads) {
+  parallelFor(
+      jobs.size(),
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          probe(jobs[i]);
+      },
+      1, threads);
+}
+
+void ImageDecoder::decode(std::vector<Job> &jobs, size_t threads) {
+  parallelFor(
+      jobs.size(),
+      [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+          decode(jobs[i]);
+      },
+      1, threads);
+}
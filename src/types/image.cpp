@@ -0,0 +1,140 @@
+#include <types/image.hpp>
+
+#include <math/simd.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Linear values are encoded through a table of this many steps
+const uint32_t ENCODE_STEPS = 4096;
+
+struct SrgbTables {
+  float decode[256];
+  uint8_t encode[ENCODE_STEPS + 1];
+
+  SrgbTables() {
+    for (uint32_t i = 0; i < 256; i++) {
+      float c = i / 255.0f;
+      decode[i] = c <= 0.04045f ? c / 12.92f
+                                : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    for (uint32_t i = 0; i <= ENCODE_STEPS; i++) {
+      float l = static_cast<float>(i) / ENCODE_STEPS;
+      float c = l <= 0.0031308f ? l * 12.92f
+                                : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+      encode[i] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+    }
+  }
+};
+
+static const SrgbTables &srgbTables() {
+  static const SrgbTables tables;
+  return tables;
+}
+
+// Row of floats padded to whole SIMD lanes
+struct Row {
+  float *data;
+
+  Row(size_t count) {
+    size_t bytes = (count * sizeof(float) + 63) / 64 * 64;
+    data = static_cast<float *>(aligned_alloc(64, bytes));
+    if (!data)
+      throw std::bad_alloc();
+    memset(data, 0, bytes);
+  }
+  ~Row() { free(data); }
+};
+
+Image::Image(uint32_t width, uint32_t height, const void *rgba)
+    : width(width), height(height) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(rgba);
+  pixels.assign(bytes, bytes + size_t(width) * height * 4);
+}
+
+uint32_t Image::fullMipLevels(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+    levels++;
+  return levels;
+}
+
+uint32_t Image::levelWidth(uint32_t level) const {
+  return std::max(width >> level, 1u);
+}
+
+uint32_t Image::levelHeight(uint32_t level) const {
+  return std::max(height >> level, 1u);
+}
+
+size_t Image::levelOffset(uint32_t level) const {
+  size_t offset = 0;
+  for (uint32_t i = 0; i < level; i++)
+    offset += levelSize(i);
+  return offset;
+}
+
+size_t Image::levelSize(uint32_t level) const {
+  return size_t(levelWidth(level)) * levelHeight(level) * 4;
+}
+
+void Image::generateMips(bool srgb) {
+  mipLevels = fullMipLevels(width, height);
+  pixels.resize(levelOffset(mipLevels));
+
+  for (uint32_t level = 1; level < mipLevels; level++)
+    downsample(&pixels[levelOffset(level - 1)], levelWidth(level - 1),
+               levelHeight(level - 1), &pixels[levelOffset(level)], srgb);
+}
+
+void Image::downsample(const uint8_t *src, uint32_t width, uint32_t height,
+                       uint8_t *dst, bool srgb) {
+  using namespace __simd;
+
+  const SrgbTables &tables = srgbTables();
+
+  uint32_t dstWidth = std::max(width / 2, 1u);
+  uint32_t dstHeight = std::max(height / 2, 1u);
+
+  size_t count = size_t(width) * 4;
+  Row top(count + __simd::width), bottom(count + __simd::width);
+
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    // Odd & single-texel edges repeat the last row / column
+    const uint8_t *rows[2] = {src + size_t(2 * y) * count,
+                              src + size_t(std::min(2 * y + 1, height - 1)) *
+                                        count};
+    float *out[2] = {top.data, bottom.data};
+
+    // Decode both source rows
+    for (int r = 0; r < 2; r++)
+      for (size_t i = 0; i < count; i++)
+        out[r][i] = srgb && i % 4 != 3 ? tables.decode[rows[r][i]]
+                                       : rows[r][i] / 255.0f;
+
+    // Sum them vertically, whole lanes at a time
+    for (size_t i = 0; i < count; i += __simd::width)
+      storea(top.data + i,
+             add(loada(top.data + i), loada(bottom.data + i)));
+
+    // Sum horizontal pairs & encode
+    uint8_t *row = dst + size_t(y) * dstWidth * 4;
+    for (uint32_t x = 0; x < dstWidth; x++) {
+      const float *a = top.data + size_t(2 * x) * 4;
+      const float *b = top.data + size_t(std::min(2 * x + 1, width - 1)) * 4;
+
+      for (int c = 0; c < 4; c++) {
+        float v = std::min((a[c] + b[c]) * 0.25f, 1.0f);
+
+        row[x * 4 + c] =
+            srgb && c != 3
+                ? tables.encode[static_cast<uint32_t>(v * ENCODE_STEPS + 0.5f)]
+                : static_cast<uint8_t>(v * 255.0f + 0.5f);
+      }
+    }
+  }
+}
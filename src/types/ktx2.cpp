@@ -0,0 +1,444 @@
+#include <types/ktx2.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef KTX2_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef KTX2_ZSTD
+#include <zstd.h>
+#endif
+
+// (all fields are little-endian, as is every supported host)
+static const uint8_t IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+                                       0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// Identifier, header & index
+const size_t HEADER_SIZE = 80;
+const size_t LEVEL_INDEX_SIZE = 24;
+
+static uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static uint64_t read64(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+
+static void write32(std::vector<uint8_t> &out, size_t offset, uint32_t v) {
+  memcpy(&out[offset], &v, 4);
+}
+
+static void write64(std::vector<uint8_t> &out, size_t offset, uint64_t v) {
+  memcpy(&out[offset], &v, 8);
+}
+
+// Texels per block side & bytes per block (false for formats not read here)
+static bool blockLayout(VkFormat format, uint32_t &blockSize,
+                        uint32_t &blockBytes) {
+  blockSize = 1;
+
+  switch (format) {
+  case VK_FORMAT_R8_UNORM:
+    blockBytes = 1;
+    return true;
+  case VK_FORMAT_R8G8_UNORM:
+    blockBytes = 2;
+    return true;
+  case VK_FORMAT_R8G8B8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+  case VK_FORMAT_B8G8R8A8_UNORM:
+  case VK_FORMAT_B8G8R8A8_SRGB:
+    blockBytes = 4;
+    return true;
+  case VK_FORMAT_R16G16B16A16_SFLOAT:
+    blockBytes = 8;
+    return true;
+  case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+  case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+  case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+  case VK_FORMAT_BC4_UNORM_BLOCK:
+  case VK_FORMAT_BC4_SNORM_BLOCK:
+    blockSize = 4, blockBytes = 8;
+    return true;
+  case VK_FORMAT_BC2_UNORM_BLOCK:
+  case VK_FORMAT_BC2_SRGB_BLOCK:
+  case VK_FORMAT_BC3_UNORM_BLOCK:
+  case VK_FORMAT_BC3_SRGB_BLOCK:
+  case VK_FORMAT_BC5_UNORM_BLOCK:
+  case VK_FORMAT_BC5_SNORM_BLOCK:
+  case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+  case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+  case VK_FORMAT_BC7_UNORM_BLOCK:
+  case VK_FORMAT_BC7_SRGB_BLOCK:
+    blockSize = 4, blockBytes = 16;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Supercompression
+
+static std::vector<uint8_t> inflate(Ktx2Texture::Supercompression scheme,
+                                    [[maybe_unused]] const uint8_t *data,
+                                    [[maybe_unused]] size_t size,
+                                    size_t uncompressedSize) {
+  std::vector<uint8_t> out(uncompressedSize);
+  bool ok = false;
+
+  switch (scheme) {
+#ifdef KTX2_ZLIB
+  case Ktx2Texture::Zlib: {
+    uLongf length = uncompressedSize;
+    ok = uncompress(out.data(), &length, data, size) == Z_OK &&
+         length == uncompressedSize;
+    break;
+  }
+#endif
+#ifdef KTX2_ZSTD
+  case Ktx2Texture::Zstandard: {
+    size_t length = ZSTD_decompress(out.data(), out.size(), data, size);
+    ok = !ZSTD_isError(length) && length == uncompressedSize;
+    break;
+  }
+#endif
+  default:
+    break;
+  }
+
+  if (!ok)
+    throw std::runtime_error("failed to inflate ktx2 level");
+
+  return out;
+}
+
+static std::vector<uint8_t> deflate(Ktx2Texture::Supercompression scheme,
+                                    const uint8_t *data, size_t size) {
+  std::vector<uint8_t> out;
+
+  switch (scheme) {
+#ifdef KTX2_ZLIB
+  case Ktx2Texture::Zlib: {
+    uLongf length = compressBound(size);
+    out.resize(length);
+    if (compress2(out.data(), &length, data, size, Z_BEST_COMPRESSION) !=
+        Z_OK)
+      throw std::runtime_error("failed to deflate ktx2 level");
+    out.resize(length);
+    break;
+  }
+#endif
+#ifdef KTX2_ZSTD
+  case Ktx2Texture::Zstandard: {
+    out.resize(ZSTD_compressBound(size));
+    size_t length = ZSTD_compress(out.data(), out.size(), data, size, 19);
+    if (ZSTD_isError(length))
+      throw std::runtime_error("failed to deflate ktx2 level");
+    out.resize(length);
+    break;
+  }
+#endif
+  default:
+    out.assign(data, data + size);
+    break;
+  }
+
+  return out;
+}
+
+// Data Format Descriptor (basic block, for the formats written here)
+static std::vector<uint32_t> dataFormatDescriptor(VkFormat format) {
+  struct Sample {
+    uint32_t offset, length, channel, upper;
+  };
+
+  const uint32_t LINEAR = 0x10; // sample qualifier (alpha of sRGB data)
+  const uint32_t FULL = 0xFFFFFFFF;
+
+  uint32_t model, blockSize, bytes;
+  bool srgb = false;
+  std::vector<Sample> samples;
+
+  switch (format) {
+  case VK_FORMAT_R8G8B8A8_SRGB:
+    srgb = true;
+    [[fallthrough]];
+  case VK_FORMAT_R8G8B8A8_UNORM:
+    model = 1, blockSize = 1, bytes = 4;
+    samples = {{0, 8, 0, 255},
+               {8, 8, 1, 255},
+               {16, 8, 2, 255},
+               {24, 8, 15u | (srgb ? LINEAR : 0), 255}};
+    break;
+  case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    srgb = true;
+    [[fallthrough]];
+  case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    model = 128, blockSize = 4, bytes = 8;
+    samples = {{0, 64, 0, FULL}};
+    break;
+  case VK_FORMAT_BC3_SRGB_BLOCK:
+    srgb = true;
+    [[fallthrough]];
+  case VK_FORMAT_BC3_UNORM_BLOCK:
+    model = 130, blockSize = 4, bytes = 16;
+    samples = {{0, 64, 15u | (srgb ? LINEAR : 0), FULL}, {64, 64, 0, FULL}};
+    break;
+  case VK_FORMAT_BC5_UNORM_BLOCK:
+    model = 132, blockSize = 4, bytes = 16;
+    samples = {{0, 64, 0, FULL}, {64, 64, 1, FULL}};
+    break;
+  case VK_FORMAT_BC7_SRGB_BLOCK:
+    srgb = true;
+    [[fallthrough]];
+  case VK_FORMAT_BC7_UNORM_BLOCK:
+    model = 134, blockSize = 4, bytes = 16;
+    samples = {{0, 128, 0, FULL}};
+    break;
+  default:
+    throw std::runtime_error("unsupported ktx2 format");
+  }
+
+  uint32_t blockBytes = 24 + 16 * samples.size();
+
+  std::vector<uint32_t> out = {
+      4 + blockBytes,
+      0, // Khronos vendor, basic descriptor
+      2 | blockBytes << 16,
+      model | 1 << 8 | (srgb ? 2 : 1) << 16, // BT.709 primaries
+      (blockSize - 1) | (blockSize - 1) << 8,
+      bytes,
+      0};
+
+  for (const Sample &sample : samples) {
+    out.push_back(sample.offset | (sample.length - 1) << 16 |
+                  sample.channel << 24);
+    out.push_back(0);
+    out.push_back(0);
+    out.push_back(sample.upper);
+  }
+
+  return out;
+}
+
+static VkFormat blockFormat(BlockFormat format, bool srgb) {
+  switch (format) {
+  case BlockFormat::BC1:
+    return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+  case BlockFormat::BC3:
+    return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+  case BlockFormat::BC5:
+    return VK_FORMAT_BC5_UNORM_BLOCK;
+  default:
+    return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  }
+}
+
+struct LevelData {
+  const uint8_t *data;
+  size_t size;
+};
+
+static void writeFile(const char *path, VkFormat format, uint32_t width,
+                      uint32_t height, uint32_t alignment,
+                      const std::vector<LevelData> &levels,
+                      Ktx2Texture::Supercompression scheme) {
+  if (!Ktx2Texture::supports(scheme))
+    throw std::runtime_error("ktx2 supercompression is not supported");
+
+  std::vector<uint32_t> dfd = dataFormatDescriptor(format);
+
+  size_t dfdOffset = HEADER_SIZE + LEVEL_INDEX_SIZE * levels.size();
+  size_t dfdSize = dfd.size() * 4;
+
+  std::vector<uint8_t> out(dfdOffset + dfdSize);
+  memcpy(out.data(), IDENTIFIER, sizeof(IDENTIFIER));
+
+  write32(out, 12, format);
+  write32(out, 16, 1); // typeSize
+  write32(out, 20, width);
+  write32(out, 24, height);
+  write32(out, 28, 0); // pixelDepth
+  write32(out, 32, 0); // layerCount
+  write32(out, 36, 1); // faceCount
+  write32(out, 40, levels.size());
+  write32(out, 44, scheme);
+
+  write32(out, 48, dfdOffset);
+  write32(out, 52, dfdSize);
+  memcpy(&out[dfdOffset], dfd.data(), dfdSize);
+
+  // Levels are stored smallest first (supercompressed ones unaligned)
+  for (size_t i = levels.size(); i-- > 0;) {
+    std::vector<uint8_t> stored =
+        deflate(scheme, levels[i].data, levels[i].size);
+
+    size_t offset = out.size();
+    if (scheme == Ktx2Texture::None)
+      offset = (offset + alignment - 1) / alignment * alignment;
+
+    out.resize(offset + stored.size());
+    memcpy(&out[offset], stored.data(), stored.size());
+
+    size_t index = HEADER_SIZE + LEVEL_INDEX_SIZE * i;
+    write64(out, index, offset);
+    write64(out, index + 8, stored.size());
+    write64(out, index + 16, levels[i].size);
+  }
+
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    throw std::runtime_error("failed to create ktx2 file");
+
+  bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+  ok = fclose(f) == 0 && ok;
+
+  if (!ok)
+    throw std::runtime_error("failed to write ktx2 file");
+}
+
+// KTX2 Texture
+
+Ktx2Texture::Ktx2Texture(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("failed to open ktx2 file");
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    mappingSize = st.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+
+  if (!mapping || mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw std::runtime_error("failed to map ktx2 file");
+  }
+
+  try {
+    const uint8_t *file = static_cast<const uint8_t *>(mapping);
+
+    if (mappingSize < HEADER_SIZE ||
+        memcmp(file, IDENTIFIER, sizeof(IDENTIFIER)))
+      throw std::runtime_error("not a ktx2 file");
+
+    format = static_cast<VkFormat>(read32(file + 12));
+    width = read32(file + 20);
+    height = read32(file + 24);
+
+    uint32_t depth = read32(file + 28), layers = read32(file + 32);
+    uint32_t faces = read32(file + 36);
+    uint32_t levelCount = std::max(read32(file + 40), 1u);
+    supercompression = static_cast<Supercompression>(read32(file + 44));
+
+    if (format == VK_FORMAT_UNDEFINED || !width || !height || depth ||
+        layers > 1 || faces != 1)
+      throw std::runtime_error("unsupported ktx2 texture (2D only)");
+
+    uint32_t blockSize, blockBytes;
+    if (!blockLayout(format, blockSize, blockBytes))
+      throw std::runtime_error("unsupported ktx2 format");
+
+    if (levelCount > Image::fullMipLevels(width, height))
+      throw std::runtime_error("ktx2 file has more levels than its extent");
+
+    if (!supports(supercompression))
+      throw std::runtime_error("unsupported ktx2 supercompression");
+
+    if (HEADER_SIZE + LEVEL_INDEX_SIZE * levelCount > mappingSize)
+      throw std::runtime_error("truncated ktx2 file");
+
+    for (uint32_t i = 0; i < levelCount; i++) {
+      const uint8_t *index = file + HEADER_SIZE + LEVEL_INDEX_SIZE * i;
+      uint64_t offset = read64(index), size = read64(index + 8);
+      uint64_t uncompressedSize = read64(index + 16);
+
+      if (offset > mappingSize || size > mappingSize - offset)
+        throw std::runtime_error("truncated ktx2 file");
+
+      Level level{file + offset, size, std::max(width >> i, 1u),
+                  std::max(height >> i, 1u)};
+
+      // Levels are uploaded & streamed assuming exactly this size
+      uint64_t expected = uint64_t((level.width + blockSize - 1) / blockSize) *
+                          ((level.height + blockSize - 1) / blockSize) *
+                          blockBytes;
+      if ((supercompression == None ? size : uncompressedSize) != expected)
+        throw std::runtime_error("ktx2 level has the wrong size");
+
+      if (supercompression != None) {
+        inflated.push_back(
+            inflate(supercompression, level.data, size, uncompressedSize));
+        level.data = inflated.back().data();
+        level.size = inflated.back().size();
+      }
+
+      levels.push_back(level);
+    }
+  } catch (...) {
+    munmap(mapping, mappingSize);
+    throw;
+  }
+}
+
+Ktx2Texture::~Ktx2Texture() { munmap(mapping, mappingSize); }
+
+size_t Ktx2Texture::size() const {
+  size_t out = 0;
+  for (const Level &level : levels)
+    out += level.size;
+  return out;
+}
+
+bool Ktx2Texture::supports(Supercompression scheme) {
+  switch (scheme) {
+  case None:
+    return true;
+#ifdef KTX2_ZLIB
+  case Zlib:
+    return true;
+#endif
+#ifdef KTX2_ZSTD
+  case Zstandard:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+void Ktx2Texture::write(const char *path, const Image &image, bool srgb,
+                        Supercompression scheme) {
+  std::vector<LevelData> levels;
+  for (uint32_t i = 0; i < image.mipLevels; i++)
+    levels.push_back({&image.pixels[image.levelOffset(i)], image.levelSize(i)});
+
+  writeFile(path, srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+            image.width, image.height, 4, levels, scheme);
+}
+
+void Ktx2Texture::write(const char *path, const CompressedImage &image,
+                        bool srgb, Supercompression scheme) {
+  std::vector<LevelData> levels;
+  for (uint32_t i = 0; i < image.mipLevels; i++)
+    levels.push_back({&image.data[image.levelOffset(i)], image.levelSize(i)});
+
+  writeFile(path, blockFormat(image.format, srgb), image.width, image.height,
+            CompressedImage::blockSize(image.format), levels, scheme);
+}
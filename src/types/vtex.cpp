@@ -0,0 +1,221 @@
+#include <types/bc.hpp>
+#include <types/jobs.hpp>
+#include <types/vtex.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t MAGIC = 0x58455456; // "VTEX"
+const uint32_t VERSION = 1;
+
+const uint64_t DATA_ALIGNMENT = 4096;
+
+static bool isPowerOfTwo(uint32_t x) { return x && !(x & (x - 1)); }
+
+static uint64_t tileBytes(bool bc7, uint32_t storedSize) {
+  return bc7 ? uint64_t(storedSize / 4) * (storedSize / 4) * 16
+             : uint64_t(storedSize) * storedSize * 4;
+}
+
+// Tiled Texture
+
+TiledTexture::TiledTexture(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("failed to open tiled texture");
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    mappingSize = st.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+
+  if (!mapping || mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw std::runtime_error("failed to map tiled texture");
+  }
+
+  try {
+    if (mappingSize < sizeof(Header))
+      throw std::runtime_error("not a tiled texture");
+
+    memcpy(&header, mapping, sizeof(Header));
+
+    if (header.magic != MAGIC || header.version != VERSION)
+      throw std::runtime_error("not a tiled texture");
+
+    bool bc7 = format() == VK_FORMAT_BC7_UNORM_BLOCK ||
+               format() == VK_FORMAT_BC7_SRGB_BLOCK;
+    bool rgba8 = format() == VK_FORMAT_R8G8B8A8_UNORM ||
+                 format() == VK_FORMAT_R8G8B8A8_SRGB;
+
+    if ((!bc7 && !rgba8) || !isPowerOfTwo(header.tileSize) ||
+        !isPowerOfTwo(header.width) || !isPowerOfTwo(header.height) ||
+        !header.levels || header.levels > 16 ||
+        std::min(header.width, header.height) >> (header.levels - 1) !=
+            header.tileSize ||
+        header.tileBytes != ::tileBytes(bc7, storedSize()))
+      throw std::runtime_error("unsupported tiled texture");
+
+    if (header.dataOffset > mappingSize ||
+        (mappingSize - header.dataOffset) / header.tileBytes < tileCount())
+      throw std::runtime_error("truncated tiled texture");
+  } catch (...) {
+    munmap(mapping, mappingSize);
+    throw;
+  }
+
+  // Tiles are read as they are requested, in no particular order
+  madvise(mapping, mappingSize, MADV_RANDOM);
+}
+
+TiledTexture::~TiledTexture() { munmap(mapping, mappingSize); }
+
+VkFormat TiledTexture::format() const {
+  return static_cast<VkFormat>(header.format);
+}
+
+uint32_t TiledTexture::storedSize() const {
+  return header.tileSize + 2 * header.border;
+}
+
+uint32_t TiledTexture::pagesX(uint32_t level) const {
+  return (header.width >> level) / header.tileSize;
+}
+
+uint32_t TiledTexture::pagesY(uint32_t level) const {
+  return (header.height >> level) / header.tileSize;
+}
+
+uint32_t TiledTexture::firstTile(uint32_t level) const {
+  uint32_t index = 0;
+  for (uint32_t i = 0; i < level; i++)
+    index += pagesX(i) * pagesY(i);
+  return index;
+}
+
+uint32_t TiledTexture::tileCount() const { return firstTile(header.levels); }
+
+const uint8_t *TiledTexture::tile(uint32_t index) const {
+  return static_cast<const uint8_t *>(mapping) + header.dataOffset +
+         index * header.tileBytes;
+}
+
+void TiledTexture::write(const char *path, const uint8_t *rgba,
+                         uint32_t width, uint32_t height, bool srgb, bool bc7,
+                         uint32_t tileSize, uint32_t border, bool wrapX) {
+  if (!isPowerOfTwo(width) || !isPowerOfTwo(height) ||
+      !isPowerOfTwo(tileSize) || tileSize < 4 ||
+      std::min(width, height) < tileSize)
+    throw std::runtime_error("tiled textures need power of two extents of at "
+                             "least a tile");
+
+  if (bc7 && border % 4)
+    throw std::runtime_error("bc7 tiles need a border of whole blocks");
+
+  Header header{};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.format = bc7 ? (srgb ? VK_FORMAT_BC7_SRGB_BLOCK
+                              : VK_FORMAT_BC7_UNORM_BLOCK)
+                      : (srgb ? VK_FORMAT_R8G8B8A8_SRGB
+                              : VK_FORMAT_R8G8B8A8_UNORM);
+  header.width = width;
+  header.height = height;
+  header.tileSize = tileSize;
+  header.border = border;
+  header.dataOffset = DATA_ALIGNMENT;
+
+  for (uint32_t side = std::min(width, height); side >= tileSize;
+       side >>= 1)
+    header.levels++;
+
+  uint32_t stored = tileSize + 2 * border;
+  header.tileBytes = tileBytes(bc7, stored);
+
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    throw std::runtime_error("failed to create tiled texture");
+
+  std::vector<uint8_t> padding(header.dataOffset - sizeof(Header));
+  bool ok = fwrite(&header, sizeof(Header), 1, f) == 1 &&
+            fwrite(padding.data(), 1, padding.size(), f) == padding.size();
+
+  // Level 0 is read in place, only the level below it is kept around & tiles
+  // are written one row of pages at a time
+  const uint8_t *level = rgba;
+  std::vector<uint8_t> levelData;
+
+  for (uint32_t l = 0; l < header.levels && ok; l++) {
+    uint32_t pagesX = width / tileSize, pagesY = height / tileSize;
+    std::vector<uint8_t> tiles(size_t(pagesX) * header.tileBytes);
+
+    for (uint32_t py = 0; py < pagesY && ok; py++) {
+      parallelFor(pagesX, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> texels(size_t(stored) * stored * 4);
+
+        for (size_t t = begin; t < end; t++) {
+          int32_t x0 = int32_t(t * tileSize) - int32_t(border);
+          int32_t y0 = int32_t(py * tileSize) - int32_t(border);
+
+          // Borders wrap or repeat the image's edge
+          for (uint32_t y = 0; y < stored; y++) {
+            int32_t sy = std::clamp<int32_t>(y0 + y, 0, height - 1);
+
+            for (uint32_t x = 0; x < stored; x++) {
+              int32_t sx = x0 + int32_t(x);
+              sx = wrapX ? (sx % int32_t(width) + width) % width
+                         : std::clamp<int32_t>(sx, 0, width - 1);
+
+              memcpy(&texels[(size_t(y) * stored + x) * 4],
+                     &level[(size_t(sy) * width + sx) * 4], 4);
+            }
+          }
+
+          uint8_t *out = &tiles[t * header.tileBytes];
+          if (!bc7) {
+            memcpy(out, texels.data(), texels.size());
+            continue;
+          }
+
+          uint8_t block[64];
+          for (uint32_t by = 0; by < stored / 4; by++)
+            for (uint32_t bx = 0; bx < stored / 4; bx++, out += 16) {
+              for (uint32_t row = 0; row < 4; row++)
+                memcpy(block + row * 16,
+                       &texels[((size_t(by) * 4 + row) * stored + bx * 4) * 4],
+                       16);
+
+              CompressedImage::encodeBC7(block, out);
+            }
+        }
+      });
+
+      ok = fwrite(tiles.data(), 1, tiles.size(), f) == tiles.size();
+    }
+
+    if (l + 1 < header.levels) {
+      std::vector<uint8_t> next(size_t(width / 2) * (height / 2) * 4);
+      Image::downsample(level, width, height, next.data(), srgb);
+
+      levelData = std::move(next);
+      level = levelData.data();
+      width /= 2;
+      height /= 2;
+    }
+  }
+
+  ok = fclose(f) == 0 && ok;
+
+  if (!ok)
+    throw std::runtime_error("failed to write tiled texture");
+}
@@ -0,0 +1,91 @@
+#include <vk/uniform.hpp>
+
+#include <algorithm>
+
+UniformArena::UniformArena(VkPhysicalDevice physicalDevice,
+                           Allocator *allocator, uint32_t frames,
+                           VkDeviceSize frameSize)
+    : allocator(allocator) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  alignment = std::max<VkDeviceSize>(
+      properties.limits.minUniformBufferOffsetAlignment, 1);
+
+  // Keep every slice starting on an aligned offset
+  this->frameSize = (frameSize + alignment - 1) / alignment * alignment;
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = this->frameSize * frames;
+  bufferInfo.usage =
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  allocator->createBuffer(bufferInfo, MemoryUsage::Dynamic, buffer, memory);
+  mapped = static_cast<char *>(memory.mapped);
+
+  if (!mapped) {
+    // No resizable BAR, stage through a shadow with the same layout
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    allocator->createBuffer(bufferInfo, MemoryUsage::Staging, shadow,
+                            shadowMemory);
+    mapped = static_cast<char *>(shadowMemory.mapped);
+  }
+}
+
+UniformArena::~UniformArena() {
+  if (shadow)
+    allocator->destroyBuffer(shadow, shadowMemory);
+
+  allocator->destroyBuffer(buffer, memory);
+}
+
+void UniformArena::begin(uint32_t frame) {
+  base = frame * frameSize;
+  head = 0;
+}
+
+UniformArena::Region UniformArena::allocate(VkDeviceSize size) {
+  VkDeviceSize offset = (head + alignment - 1) / alignment * alignment;
+
+  if (offset + size > frameSize)
+    throw std::runtime_error("uniform arena frame slice is full");
+
+  head = offset + size;
+  highWater = std::max(highWater, head);
+
+  return {static_cast<uint32_t>(base + offset), mapped + base + offset};
+}
+
+void UniformArena::record(VkCommandBuffer commandBuffer) {
+  if (!shadow || head == 0)
+    return;
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = base;
+  copyRegion.dstOffset = base;
+  copyRegion.size = head;
+  vkCmdCopyBuffer(commandBuffer, shadow, buffer, 1, &copyRegion);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = base;
+  barrier.size = head;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+VkDeviceSize UniformArena::used() const { return head; }
+
+VkDeviceSize UniformArena::peak() const { return highWater; }
+
+bool UniformArena::direct() const { return !shadow; }
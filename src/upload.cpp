@@ -0,0 +1,320 @@
+#include <vk/upload.hpp>
+
+UploadBatch::UploadBatch(VkDevice device, StagingRing *staging,
+                         Queue transfer, Queue graphics)
+    : device(device), staging(staging), transfer(transfer),
+      graphics(graphics) {}
+
+UploadBatch::~UploadBatch() {
+  if (recording) {
+    vkEndCommandBuffer(commandBuffer);
+    freeCommandBuffers.push_back(commandBuffer);
+  }
+
+  staging->wait(serial);
+  for (auto &submitted : inFlight)
+    freeCommandBuffers.push_back(submitted.first);
+
+  if (!freeCommandBuffers.empty())
+    vkFreeCommandBuffers(device, transfer.commandPool,
+                         static_cast<uint32_t>(freeCommandBuffers.size()),
+                         freeCommandBuffers.data());
+
+  for (auto &h : handoffs)
+    vkWaitForFences(device, 1, &h.fence, VK_TRUE, UINT64_MAX);
+
+  handoffs.insert(handoffs.end(), freeHandoffs.begin(), freeHandoffs.end());
+  for (auto &h : handoffs) {
+    vkDestroySemaphore(device, h.semaphore, nullptr);
+    vkDestroyFence(device, h.fence, nullptr);
+    vkFreeCommandBuffers(device, graphics.commandPool, 1, &h.commandBuffer);
+  }
+}
+
+VkCommandBuffer UploadBatch::record() {
+  transferCount++;
+  return begin();
+}
+
+void UploadBatch::releaseBuffer(VkBuffer buffer, VkAccessFlags dstAccess,
+                                VkPipelineStageFlags dstStage) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+
+  if (!dedicated()) {
+    vkCmdPipelineBarrier(begin(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+    return;
+  }
+
+  // Release (access on the destination queue is up to the acquire)
+  barrier.srcQueueFamilyIndex = transfer.family;
+  barrier.dstQueueFamilyIndex = graphics.family;
+  barrier.dstAccessMask = 0;
+
+  vkCmdPipelineBarrier(begin(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+
+  // Acquire (matching barrier, recorded at submit)
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = dstAccess;
+  bufferAcquires.push_back(barrier);
+  acquireStages |= dstStage;
+}
+
+void UploadBatch::releaseImage(VkImage image, VkImageLayout oldLayout,
+                               VkImageLayout newLayout, VkAccessFlags dstAccess,
+                               VkPipelineStageFlags dstStage,
+                               uint32_t mipLevels, uint32_t layers) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = dstAccess;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = mipLevels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = layers;
+
+  if (!dedicated()) {
+    vkCmdPipelineBarrier(begin(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+    return;
+  }
+
+  // Release (the layout transition happens once, between release & acquire)
+  barrier.srcQueueFamilyIndex = transfer.family;
+  barrier.dstQueueFamilyIndex = graphics.family;
+  barrier.dstAccessMask = 0;
+
+  vkCmdPipelineBarrier(begin(), VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  // Acquire (matching barrier, recorded at submit)
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = dstAccess;
+  imageAcquires.push_back(barrier);
+  acquireStages |= dstStage;
+}
+
+void UploadBatch::recordGraphics(
+    std::function<void(VkCommandBuffer)> record) {
+  transferCount++;
+
+  // Same family, the batch runs on a graphics-capable queue already
+  if (!dedicated()) {
+    record(begin());
+    return;
+  }
+
+  graphicsWork.push_back(std::move(record));
+}
+
+uint64_t UploadBatch::submit() {
+  if (!recording)
+    return 0;
+
+  // Make transfer writes visible to whatever reads them in later submissions
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    throw std::runtime_error("failed to record upload command buffer");
+
+  recording = false;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+
+  if (bufferAcquires.empty() && imageAcquires.empty() &&
+      graphicsWork.empty()) {
+    // Submit through the staging ring, so it can reclaim the regions read
+    serial = staging->submit(transfer.queue, submitInfo);
+    submissionCount++;
+
+    inFlight.push_back({commandBuffer, serial});
+    return serial;
+  }
+
+  // Signal the graphics queue once the transfer is done
+  Handoff h = getHandoff();
+
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &h.semaphore;
+
+  serial = staging->submit(transfer.queue, submitInfo);
+  submissionCount++;
+
+  inFlight.push_back({commandBuffer, serial});
+
+  // Acquire on the graphics queue (later submissions there are ordered after
+  // these barriers, so draws need no extra waits)
+  if (!acquireStages)
+    acquireStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+  vkBeginCommandBuffer(h.commandBuffer, &beginInfo);
+  if (!bufferAcquires.empty() || !imageAcquires.empty())
+    vkCmdPipelineBarrier(h.commandBuffer, acquireStages, acquireStages, 0, 0,
+                         nullptr, static_cast<uint32_t>(bufferAcquires.size()),
+                         bufferAcquires.data(),
+                         static_cast<uint32_t>(imageAcquires.size()),
+                         imageAcquires.data());
+
+  for (auto &record : graphicsWork)
+    record(h.commandBuffer);
+  vkEndCommandBuffer(h.commandBuffer);
+
+  VkSubmitInfo acquireInfo{};
+  acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  acquireInfo.waitSemaphoreCount = 1;
+  acquireInfo.pWaitSemaphores = &h.semaphore;
+  acquireInfo.pWaitDstStageMask = &acquireStages;
+  acquireInfo.commandBufferCount = 1;
+  acquireInfo.pCommandBuffers = &h.commandBuffer;
+
+  if (vkQueueSubmit(graphics.queue, 1, &acquireInfo, h.fence) != VK_SUCCESS)
+    throw std::runtime_error("failed to submit upload acquire commands");
+
+  handoffs.push_back(h);
+
+  bufferAcquires.clear();
+  imageAcquires.clear();
+  graphicsWork.clear();
+  acquireStages = 0;
+
+  return serial;
+}
+
+void UploadBatch::flush() { staging->wait(submit()); }
+
+bool UploadBatch::dedicated() const {
+  return transfer.family != graphics.family;
+}
+
+UploadBatch::Stats UploadBatch::stats() const {
+  Stats stats;
+  stats.transfers = transferCount;
+  stats.submissions = submissionCount;
+  stats.roundTripsSaved = transferCount - submissionCount;
+  stats.dedicated = dedicated();
+  return stats;
+}
+
+VkCommandBuffer UploadBatch::begin() {
+  if (!recording) {
+    // Earlier batches may still be executing, record into a buffer of its own
+    commandBuffer = getCommandBuffer();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+      throw std::runtime_error("failed to begin upload command buffer");
+
+    recording = true;
+  }
+
+  return commandBuffer;
+}
+
+VkCommandBuffer UploadBatch::getCommandBuffer() {
+  // Recycle command buffers whose transfer has finished
+  uint64_t completed = staging->completed();
+
+  for (size_t i = 0; i < inFlight.size();)
+    if (inFlight[i].second <= completed) {
+      freeCommandBuffers.push_back(inFlight[i].first);
+
+      inFlight[i] = inFlight.back();
+      inFlight.pop_back();
+    } else
+      i++;
+
+  if (!freeCommandBuffers.empty()) {
+    VkCommandBuffer idle = freeCommandBuffers.back();
+    freeCommandBuffers.pop_back();
+    return idle;
+  }
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = transfer.commandPool;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer allocated;
+  if (vkAllocateCommandBuffers(device, &allocInfo, &allocated) != VK_SUCCESS)
+    throw std::runtime_error("failed to allocate upload command buffer");
+
+  return allocated;
+}
+
+UploadBatch::Handoff UploadBatch::getHandoff() {
+  // Recycle handoffs whose acquire has finished
+  for (size_t i = 0; i < handoffs.size();)
+    if (vkGetFenceStatus(device, handoffs[i].fence) == VK_SUCCESS) {
+      vkResetFences(device, 1, &handoffs[i].fence);
+      freeHandoffs.push_back(handoffs[i]);
+
+      handoffs[i] = handoffs.back();
+      handoffs.pop_back();
+    } else
+      i++;
+
+  if (!freeHandoffs.empty()) {
+    Handoff h = freeHandoffs.back();
+    freeHandoffs.pop_back();
+    return h;
+  }
+
+  Handoff h;
+
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = graphics.commandPool;
+  allocInfo.commandBufferCount = 1;
+
+  if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &h.semaphore) !=
+          VK_SUCCESS ||
+      vkCreateFence(device, &fenceInfo, nullptr, &h.fence) != VK_SUCCESS ||
+      vkAllocateCommandBuffers(device, &allocInfo, &h.commandBuffer) !=
+          VK_SUCCESS)
+    throw std::runtime_error("failed to create upload handoff objects");
+
+  return h;
+}
@@ -0,0 +1,829 @@
+#include <vk/virtual.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Tiles waiting for the loader at most (per tile uploaded each frame)
+const uint32_t QUEUE_FRAMES = 8;
+
+// Feedback pixel of every 4x4 block, frame after frame (spread out)
+static const uint32_t JITTER[16] = {0, 10, 2, 8, 5, 15, 7, 13,
+                                    1, 11, 3, 9, 4, 14, 6, 12};
+
+VirtualTexture::VirtualTexture(VkPhysicalDevice physicalDevice,
+                               VkDevice device, Allocator *allocator,
+                               ReadbackQueue *readbacks, const char *path,
+                               uint32_t frames, Options options)
+    : physicalDevice(physicalDevice), device(device), allocator(allocator),
+      readbacks(readbacks), file(path), options(options) {
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+  uint32_t levels = file.header.levels;
+
+  // Tile Coordinates
+  tiles.resize(file.tileCount());
+  for (uint32_t level = 0; level < levels; level++)
+    for (uint32_t y = 0; y < file.pagesY(level); y++)
+      for (uint32_t x = 0; x < file.pagesX(level); x++) {
+        Tile &tile = tiles[tileIndex(level, x, y)];
+        tile.level = level;
+        tile.x = x;
+        tile.y = y;
+      }
+
+  createImages(properties);
+
+  // (the tile cache may hold fewer slots than asked for, see createImages)
+  uint32_t pinned = file.pagesX(levels - 1) * file.pagesY(levels - 1);
+  if (pinned + options.tilesPerFrame > slotTiles.size())
+    throw std::runtime_error("virtual texture cache is too small");
+
+  // Upload Slices (tiles, then page table entries: one per upload & one per
+  // eviction at most)
+  uploadSliceSize =
+      options.tilesPerFrame * file.header.tileBytes + options.tilesPerFrame * 8;
+  uploadSliceSize = (uploadSliceSize + 15) / 16 * 16;
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size = uploadSliceSize * frames;
+  bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  allocator->createBuffer(bufferInfo, MemoryUsage::Staging, upload,
+                          uploadMemory);
+
+  // Feedback Slices
+  VkDeviceSize alignment =
+      std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment,
+                             4);
+
+  feedbackWords = (file.tileCount() + 31) / 32;
+  feedbackSliceSize = (feedbackWords * 4 + alignment - 1) / alignment *
+                      alignment;
+
+  bufferInfo.size = feedbackSliceSize * frames;
+  bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                     VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  allocator->createBuffer(bufferInfo, MemoryUsage::Static, feedback,
+                          feedbackMemory);
+
+  requested.assign(feedbackWords, 0);
+
+  if (sparse()) {
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    bindSemaphores.resize(frames);
+    for (VkSemaphore &semaphore : bindSemaphores)
+      if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) !=
+          VK_SUCCESS)
+        throw std::runtime_error("failed to create sparse bind semaphore");
+  }
+
+  createDescriptors();
+
+  // The last level stays resident, it is read right away
+  for (uint32_t i = file.firstTile(levels - 1); i < tiles.size(); i++) {
+    tiles[i].state = State::Loading;
+    loaded.push_back(
+        {i, std::vector<uint8_t>(file.tile(i),
+                                 file.tile(i) + file.header.tileBytes)});
+  }
+
+  loader = std::thread(&VirtualTexture::load, this);
+}
+
+VirtualTexture::~VirtualTexture() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  loader.join();
+
+  vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+  vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+
+  for (VkSemaphore semaphore : bindSemaphores)
+    vkDestroySemaphore(device, semaphore, nullptr);
+
+  vkDestroySampler(device, sampler, nullptr);
+  vkDestroySampler(device, pageTableSampler, nullptr);
+  vkDestroyImageView(device, imageView, nullptr);
+  vkDestroyImageView(device, pageTableView, nullptr);
+
+  if (sparse()) {
+    vkDestroyImage(device, image, nullptr);
+    allocator->free(pages);
+  } else
+    allocator->destroyImage(image, imageMemory);
+
+  allocator->destroyImage(pageTable, pageTableMemory);
+  allocator->destroyBuffer(upload, uploadMemory);
+  allocator->destroyBuffer(feedback, feedbackMemory);
+}
+
+void VirtualTexture::createImages(
+    const VkPhysicalDeviceProperties &properties) {
+  // Page Table (RGBA8_UINT: slot x, slot y, unused, resident)
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = VK_FORMAT_R8G8B8A8_UINT;
+  imageInfo.extent = {file.pagesX(0), file.pagesY(0), 1};
+  imageInfo.mipLevels = file.header.levels;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage =
+      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  allocator->createImage(imageInfo, MemoryUsage::Static, pageTable,
+                         pageTableMemory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = pageTable;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R8G8B8A8_UINT;
+  viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                               file.header.levels, 0, 1};
+
+  if (vkCreateImageView(device, &viewInfo, nullptr, &pageTableView) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create page table view");
+
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod = static_cast<float>(file.header.levels);
+
+  if (vkCreateSampler(device, &samplerInfo, nullptr, &pageTableSampler) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create page table sampler");
+
+  if (options.sparse && createSparseImage())
+    return;
+
+  // Tile Cache (square grid of slots, up to 255 per side for the page table)
+  uint32_t stored = file.storedSize();
+  slotsPerSide = static_cast<uint32_t>(
+      std::ceil(std::sqrt(static_cast<double>(options.cacheSlots))));
+  slotsPerSide = std::min({slotsPerSide,
+                           properties.limits.maxImageDimension2D / stored,
+                           255u});
+
+  slotTiles.assign(slotsPerSide * slotsPerSide, -1);
+  for (uint32_t slot = slotTiles.size(); slot-- > 0;)
+    freeSlots.push_back(slot);
+
+  imageInfo.format = file.format();
+  imageInfo.extent = {slotsPerSide * stored, slotsPerSide * stored, 1};
+  imageInfo.mipLevels = 1;
+
+  allocator->createImage(imageInfo, MemoryUsage::Static, image, imageMemory);
+
+  viewInfo.image = image;
+  viewInfo.format = file.format();
+  viewInfo.subresourceRange.levelCount = 1;
+
+  if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create tile cache view");
+
+  // (the border keeps bilinear filtering inside of a tile)
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.maxLod = 0.0f;
+
+  if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    throw std::runtime_error("failed to create tile cache sampler");
+}
+
+bool VirtualTexture::createSparseImage() {
+  VkFormat format = file.format();
+  VkImageUsageFlags usage =
+      VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+  // Tiles must be exactly the pages of the sparse image
+  uint32_t count = 0;
+  vkGetPhysicalDeviceSparseImageFormatProperties(
+      physicalDevice, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, usage,
+      VK_IMAGE_TILING_OPTIMAL, &count, nullptr);
+
+  std::vector<VkSparseImageFormatProperties> formats(count);
+  vkGetPhysicalDeviceSparseImageFormatProperties(
+      physicalDevice, format, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, usage,
+      VK_IMAGE_TILING_OPTIMAL, &count, formats.data());
+
+  if (formats.empty() ||
+      formats[0].imageGranularity.width != file.header.tileSize ||
+      formats[0].imageGranularity.height != file.header.tileSize)
+    return false;
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT |
+                    VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = format;
+  imageInfo.extent = {file.header.width, file.header.height, 1};
+  imageInfo.mipLevels = file.header.levels;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = usage;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    return false;
+
+  // Every level must be made of whole pages (no mip tail)
+  count = 0;
+  vkGetImageSparseMemoryRequirements(device, image, &count, nullptr);
+
+  std::vector<VkSparseImageMemoryRequirements> sparseRequirements(count);
+  vkGetImageSparseMemoryRequirements(device, image, &count,
+                                     sparseRequirements.data());
+
+  if (sparseRequirements.empty() ||
+      sparseRequirements[0].imageMipTailFirstLod < file.header.levels) {
+    vkDestroyImage(device, image, nullptr);
+    return false;
+  }
+
+  // A memory page per slot
+  VkMemoryRequirements requirements;
+  vkGetImageMemoryRequirements(device, image, &requirements);
+
+  pageSize = requirements.alignment;
+  requirements.size = pageSize * options.cacheSlots;
+
+  pages = allocator->allocate(requirements, MemoryUsage::Static, false);
+
+  slotTiles.assign(options.cacheSlots, -1);
+  for (uint32_t slot = slotTiles.size(); slot-- > 0;)
+    freeSlots.push_back(slot);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format;
+  viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                               file.header.levels, 0, 1};
+
+  if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create sparse image view");
+
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.maxLod = static_cast<float>(file.header.levels);
+
+  if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    throw std::runtime_error("failed to create sparse image sampler");
+
+  return true;
+}
+
+void VirtualTexture::createDescriptors() {
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorCount = 1;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  }
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create virtual texture set layout");
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2};
+  poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1};
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+  poolInfo.maxSets = 1;
+
+  if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create virtual texture pool");
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &setLayout;
+
+  if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to allocate virtual texture set");
+
+  std::array<VkDescriptorImageInfo, 2> imageInfos{};
+  imageInfos[0] = {sampler, imageView,
+                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+  imageInfos[1] = {pageTableSampler, pageTableView,
+                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+  VkDescriptorBufferInfo bufferInfo{feedback, 0, feedbackWords * 4u};
+
+  std::array<VkWriteDescriptorSet, 3> writes{};
+  for (uint32_t i = 0; i < writes.size(); i++) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = descriptorSet;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+    writes[i].descriptorType = bindings[i].descriptorType;
+  }
+  writes[0].pImageInfo = &imageInfos[0];
+  writes[1].pImageInfo = &imageInfos[1];
+  writes[2].pBufferInfo = &bufferInfo;
+
+  vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()),
+                         writes.data(), 0, nullptr);
+}
+
+void VirtualTexture::load() {
+  for (;;) {
+    uint32_t index;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] { return stopping || !loadQueue.empty(); });
+
+      if (stopping)
+        return;
+
+      index = loadQueue.front();
+      loadQueue.pop_front();
+    }
+
+    // Page faults of the mapping (the actual reads) happen here
+    const uint8_t *tile = file.tile(index);
+    std::vector<uint8_t> data(tile, tile + file.header.tileBytes);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    loaded.push_back({index, std::move(data)});
+  }
+}
+
+void VirtualTexture::begin(uint32_t frame, uint64_t serial,
+                           uint64_t completed) {
+  this->frame = frame;
+  this->serial = serial;
+
+  uploads.clear();
+  entries.clear();
+
+  // Slots unmapped by finished frames can be reused
+  while (!retiring.empty() && retiring.front().serial <= completed) {
+    Retired retired = retiring.front();
+    retiring.pop_front();
+
+    // (nothing samples its page anymore, it can be unbound, unless the tile
+    // was requested again & bound to a new slot since)
+    const Tile &tile = tiles[retired.tile];
+    if (sparse() && tile.state != State::Resident) {
+
+      VkSparseImageMemoryBind bind{};
+      bind.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, tile.level, 0};
+      bind.offset = {int32_t(tile.x * file.header.tileSize),
+                     int32_t(tile.y * file.header.tileSize), 0};
+      bind.extent = {file.header.tileSize, file.header.tileSize, 1};
+      bind.memory = VK_NULL_HANDLE;
+      binds.push_back(bind);
+    }
+
+    freeSlots.push_back(retired.slot);
+  }
+
+  if (requestsChanged) {
+    requestsChanged = false;
+    feedbackSerial = serial;
+    counters.requested = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Requeue from scratch, the feedback says what is wanted now
+    for (uint32_t index : loadQueue)
+      tiles[index].state = State::Absent;
+    loadQueue.clear();
+
+    std::vector<uint32_t> wanted;
+    for (uint32_t word = 0; word < feedbackWords; word++)
+      for (uint32_t bits = requested[word]; bits; bits &= bits - 1) {
+        uint32_t index = word * 32 + __builtin_ctz(bits);
+        if (index >= tiles.size())
+          break;
+
+        counters.requested++;
+        request(index, wanted);
+      }
+
+    // Coarsest first (a tile is only uploaded once its parent is)
+    std::stable_sort(wanted.begin(), wanted.end(),
+                     [this](uint32_t a, uint32_t b) {
+                       return tiles[a].level > tiles[b].level;
+                     });
+
+    size_t queued = std::min<size_t>(
+        wanted.size(), QUEUE_FRAMES * options.tilesPerFrame);
+    loadQueue.assign(wanted.begin(), wanted.begin() + queued);
+
+    for (size_t i = queued; i < wanted.size(); i++)
+      tiles[wanted[i]].state = State::Absent;
+
+    if (queued)
+      wake.notify_one();
+  }
+
+  // Keep a budget's worth of slots free or on their way
+  while (freeSlots.size() + retiring.size() < options.tilesPerFrame &&
+         evict())
+    ;
+
+  // Take loaded tiles, as many as the budget & free slots allow
+  std::deque<Loaded> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t count = std::min<size_t>(
+        {loaded.size(), options.tilesPerFrame, freeSlots.size()});
+
+    std::move(loaded.begin(), loaded.begin() + count,
+              std::back_inserter(ready));
+    loaded.erase(loaded.begin(), loaded.begin() + count);
+  }
+
+  char *slice =
+      static_cast<char *>(uploadMemory.mapped) + frame * uploadSliceSize;
+
+  for (Loaded &tile : ready) {
+    Tile &t = tiles[tile.tile];
+
+    // Its parent was evicted meanwhile, it is requested again if needed
+    if (t.level + 1u < file.header.levels &&
+        tiles[tileIndex(t.level + 1, t.x / 2, t.y / 2)].state !=
+            State::Resident) {
+      t.state = State::Absent;
+      continue;
+    }
+
+    memcpy(slice + uploads.size() * file.header.tileBytes, tile.data.data(),
+           tile.data.size());
+    uploads.push_back(tile.tile);
+
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    makeResident(tile.tile, slot);
+  }
+
+  // Page table entries follow the tiles
+  char *entryData = slice + options.tilesPerFrame * file.header.tileBytes;
+  for (size_t i = 0; i < entries.size(); i++)
+    memcpy(entryData + i * 4, entries[i].value, 4);
+}
+
+void VirtualTexture::request(uint32_t index, std::vector<uint32_t> &wanted) {
+  // Up to the first ancestor this feedback already went through
+  for (;;) {
+    Tile &tile = tiles[index];
+    if (tile.lastUse == serial)
+      break;
+
+    tile.lastUse = serial;
+    if (tile.state == State::Absent) {
+      tile.state = State::Loading;
+      wanted.push_back(index);
+    }
+
+    if (tile.level + 1u == file.header.levels)
+      break;
+
+    index = tileIndex(tile.level + 1, tile.x / 2, tile.y / 2);
+  }
+}
+
+bool VirtualTexture::evict() {
+  // Least recently requested leaf, not requested by the latest feedback
+  int32_t victim = -1;
+
+  for (int32_t index : slotTiles) {
+    if (index < 0)
+      continue;
+
+    const Tile &tile = tiles[index];
+    if (tile.level + 1u == file.header.levels || tile.residentChildren ||
+        tile.lastUse >= feedbackSerial)
+      continue;
+
+    if (victim < 0 || tile.lastUse < tiles[victim].lastUse)
+      victim = index;
+  }
+
+  if (victim < 0)
+    return false;
+
+  Tile &tile = tiles[victim];
+  uint32_t slot = tile.slot;
+
+  tile.state = State::Absent;
+  tile.slot = -1;
+  tiles[tileIndex(tile.level + 1, tile.x / 2, tile.y / 2)].residentChildren--;
+
+  slotTiles[slot] = -1;
+  retiring.push_back({serial, slot, static_cast<uint32_t>(victim)});
+
+  // Unmapped by this frame (nothing samples a leaf through its entry after)
+  entries.push_back({static_cast<uint32_t>(victim), {0, 0, 0, 0}});
+
+  counters.evicted++;
+  return true;
+}
+
+void VirtualTexture::makeResident(uint32_t index, uint32_t slot) {
+  Tile &tile = tiles[index];
+  tile.state = State::Resident;
+  tile.slot = slot;
+  tile.lastUse = serial;
+
+  if (tile.level + 1u < file.header.levels)
+    tiles[tileIndex(tile.level + 1, tile.x / 2, tile.y / 2)]
+        .residentChildren++;
+
+  slotTiles[slot] = index;
+
+  Entry entry{index, {0, 0, 0, 1}};
+  if (!sparse()) {
+    entry.value[0] = slot % slotsPerSide;
+    entry.value[1] = slot / slotsPerSide;
+  } else {
+    VkSparseImageMemoryBind bind{};
+    bind.subresource = {VK_IMAGE_ASPECT_COLOR_BIT, tile.level, 0};
+    bind.offset = {int32_t(tile.x * file.header.tileSize),
+                   int32_t(tile.y * file.header.tileSize), 0};
+    bind.extent = {file.header.tileSize, file.header.tileSize, 1};
+    bind.memory = pages.memory;
+    bind.memoryOffset = pages.offset + slot * pageSize;
+    binds.push_back(bind);
+  }
+
+  entries.push_back(entry);
+  counters.uploaded++;
+}
+
+VkSemaphore VirtualTexture::bind(VkQueue queue) {
+  if (binds.empty())
+    return VK_NULL_HANDLE;
+
+  VkSparseImageMemoryBindInfo imageBind{};
+  imageBind.image = image;
+  imageBind.bindCount = static_cast<uint32_t>(binds.size());
+  imageBind.pBinds = binds.data();
+
+  VkBindSparseInfo bindInfo{};
+  bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+  bindInfo.imageBindCount = 1;
+  bindInfo.pImageBinds = &imageBind;
+  bindInfo.signalSemaphoreCount = 1;
+  bindInfo.pSignalSemaphores = &bindSemaphores[frame];
+
+  if (vkQueueBindSparse(queue, 1, &bindInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    throw std::runtime_error("failed to bind virtual texture pages");
+
+  binds.clear();
+  return bindSemaphores[frame];
+}
+
+void VirtualTexture::record(VkCommandBuffer commandBuffer) {
+  if (!uploads.empty() || !entries.empty() || !initialized) {
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    for (VkImageMemoryBarrier &barrier : barriers) {
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.oldLayout = initialized
+                              ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                              : VK_IMAGE_LAYOUT_UNDEFINED;
+      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                                  VK_REMAINING_MIP_LEVELS, 0, 1};
+    }
+    barriers[0].image = image;
+    barriers[1].image = pageTable;
+
+    // (earlier frames are done sampling before anything is overwritten)
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+
+    if (!initialized) {
+      // Nothing is resident yet
+      VkClearColorValue clear{};
+      VkImageSubresourceRange range = barriers[1].subresourceRange;
+      vkCmdClearColorImage(commandBuffer, pageTable,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1,
+                           &range);
+
+      VkMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0,
+                           nullptr, 0, nullptr);
+      initialized = true;
+    }
+
+    VkDeviceSize sliceOffset = frame * uploadSliceSize;
+    uint32_t stored = file.storedSize();
+    uint32_t tileSize = file.header.tileSize, border = file.header.border;
+
+    // Tiles (whole, border included, into their cache slot or only the
+    // inside into their page of the sparse image)
+    std::vector<VkBufferImageCopy> regions(uploads.size());
+    for (size_t i = 0; i < uploads.size(); i++) {
+      const Tile &tile = tiles[uploads[i]];
+      VkBufferImageCopy &region = regions[i];
+
+      region.bufferOffset = sliceOffset + i * file.header.tileBytes;
+      region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+
+      if (!sparse()) {
+        region.imageOffset = {int32_t(tile.slot % slotsPerSide * stored),
+                              int32_t(tile.slot / slotsPerSide * stored), 0};
+        region.imageExtent = {stored, stored, 1};
+        continue;
+      }
+
+      bool bc7 = file.header.tileBytes < VkDeviceSize(stored) * stored * 4;
+      region.bufferOffset +=
+          bc7 ? (VkDeviceSize(border / 4) * (stored / 4) + border / 4) * 16
+              : (VkDeviceSize(border) * stored + border) * 4;
+      region.bufferRowLength = stored;
+      region.bufferImageHeight = stored;
+      region.imageSubresource.mipLevel = tile.level;
+      region.imageOffset = {int32_t(tile.x * tileSize),
+                            int32_t(tile.y * tileSize), 0};
+      region.imageExtent = {tileSize, tileSize, 1};
+    }
+
+    if (!regions.empty())
+      vkCmdCopyBufferToImage(commandBuffer, upload, image,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             static_cast<uint32_t>(regions.size()),
+                             regions.data());
+
+    // Page table entries
+    VkDeviceSize entryOffset =
+        sliceOffset + options.tilesPerFrame * file.header.tileBytes;
+
+    regions.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+      const Tile &tile = tiles[entries[i].tile];
+
+      regions[i] = {};
+      regions[i].bufferOffset = entryOffset + i * 4;
+      regions[i].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, tile.level, 0,
+                                     1};
+      regions[i].imageOffset = {tile.x, tile.y, 0};
+      regions[i].imageExtent = {1, 1, 1};
+    }
+
+    if (!regions.empty())
+      vkCmdCopyBufferToImage(commandBuffer, upload, pageTable,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             static_cast<uint32_t>(regions.size()),
+                             regions.data());
+
+    for (VkImageMemoryBarrier &barrier : barriers) {
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, static_cast<uint32_t>(barriers.size()),
+                         barriers.data());
+  }
+
+  // Clear this frame's feedback
+  vkCmdFillBuffer(commandBuffer, feedback, feedbackOffset(),
+                  feedbackWords * 4, 0);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask =
+      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = feedback;
+  barrier.offset = feedbackOffset();
+  barrier.size = feedbackWords * 4;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+}
+
+void VirtualTexture::recordFeedback(VkCommandBuffer commandBuffer) {
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = feedback;
+  barrier.offset = feedbackOffset();
+  barrier.size = feedbackWords * 4;
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+
+  readbacks->readBuffer(commandBuffer, serial, feedback, feedbackOffset(),
+                        feedbackWords * 4,
+                        [this](const void *data, VkDeviceSize size) {
+                          memcpy(requested.data(), data, size);
+                          requestsChanged = true;
+                        });
+}
+
+VirtualTexture::Params VirtualTexture::params() const {
+  Params params{};
+  params.pages[0] = static_cast<float>(file.pagesX(0));
+  params.pages[1] = static_cast<float>(file.pagesY(0));
+  params.tileSize = static_cast<float>(file.header.tileSize);
+  params.border = static_cast<float>(file.header.border);
+  params.cacheSize =
+      sparse() ? 0.0f : static_cast<float>(slotsPerSide * file.storedSize());
+  params.levels = file.header.levels;
+  params.jitter = JITTER[serial % 16];
+
+  for (uint32_t level = 0; level < file.header.levels; level++)
+    params.firstTile[level] = file.firstTile(level);
+
+  return params;
+}
+
+uint32_t VirtualTexture::feedbackOffset() const {
+  return static_cast<uint32_t>(frame * feedbackSliceSize);
+}
+
+bool VirtualTexture::sparse() const { return pageSize != 0; }
+
+VirtualTexture::Stats VirtualTexture::stats() {
+  Stats stats = counters;
+  stats.slots = static_cast<uint32_t>(slotTiles.size());
+  stats.sparse = sparse();
+  stats.resident = static_cast<uint32_t>(
+      slotTiles.size() -
+      std::count(slotTiles.begin(), slotTiles.end(), int32_t(-1)));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  stats.loading = static_cast<uint32_t>(loadQueue.size() + loaded.size());
+  return stats;
+}
+
+uint32_t VirtualTexture::tileIndex(uint32_t level, uint32_t x,
+                                   uint32_t y) const {
+  return file.firstTile(level) + y * file.pagesX(level) + x;
+}
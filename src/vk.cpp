@@ -2,16 +2,35 @@
 
 #include <vulkan/vulkan.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <types/jobs.hpp>
 
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <set>
 #include <stdexcept>
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Staging memory decoded into at once by loadTextures
+// (a wave is submitted before the next one is decoded; images larger than
+// the staging ring make a wave of their own, staged in their own buffer)
+const VkDeviceSize TEXTURE_WAVE_SIZE = 32 * 1024 * 1024;
+
+// Levels of streamed textures uploaded before the first frame
+// (the ones up to this size, along their largest side)
+const uint32_t STREAMING_TAIL_SIZE = 64;
+
+// Virtual texture shaders (compiled into the build directory, none without
+// glslc)
+#ifdef VIRTUAL_SHADER_DIR
+const char *VIRTUAL_FRAG_SHADER = VIRTUAL_SHADER_DIR "/frag.spv";
+const char *VIRTUAL_SPARSE_SHADER = VIRTUAL_SHADER_DIR "/sparse.spv";
+#else
+const char *VIRTUAL_FRAG_SHADER = nullptr;
+const char *VIRTUAL_SPARSE_SHADER = nullptr;
+#endif
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -36,19 +55,58 @@ VulkanBase::VulkanBase(Model model, const char *title, vec<2, int> size)
 
   pickPhysicalDevice();
   createLogicalDevice();
+
+  allocator = new Allocator(physicalDevice, device, memoryBudgetSupported);
+  staging = new StagingRing(device, allocator);
+  deletions = new DeletionQueue();
+  readbacks = new ReadbackQueue(device, allocator);
+  samplers = new SamplerCache(physicalDevice, device, samplerAnisotropy);
+  streamer = new TextureStreamer(device, allocator, deletions,
+                                 MAX_FRAMES_IN_FLIGHT);
+
   createSwapChain();
   createImageViews();
   createRenderPass();
 
   // TODO: dynamic GPipeline Creation
   createDescriptorSetLayout();
+  createVirtualTexture("../../res/earth.vtex");
   createGraphicsPipeline();
 
   createDepthResources();
   createFramebuffers();
 
+  if (enableValidationLayers) {
+    TransientPool::Report report = transients->report();
+    printf("transient: %u attachment(s) in %u allocation(s), %.1f MB "
+           "(%.1f MB saved by aliasing)%s\n",
+           report.attachments, report.allocations,
+           report.allocated / 1048576.0,
+           (report.dedicated - report.allocated) / 1048576.0,
+           report.lazy ? ", lazily allocated" : "");
+  }
+
   createCommandPool();
 
+  QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+  uploads = new UploadBatch(
+      device, staging,
+      {transferQueue, transferCommandPool,
+       indices.transferFamily.value_or(indices.graphicsFamily.value())},
+      {graphicsQueue, commandPool, indices.graphicsFamily.value()});
+
+  textures = new TextureManager(
+      allocator,
+      [this](const std::vector<std::string> &paths) {
+        return loadTextures(paths);
+      },
+      [this](Texture &texture) { destroyTexture(texture); },
+      [this](Texture &texture) {
+        vkDestroyImageView(device, texture.view, nullptr);
+        allocator->destroyImage(texture.image, texture.memory);
+        texture = Texture();
+      });
+
   // TODO: dynamic Texture Loading
   createTextureImage();
   createTextureImageView();
@@ -57,6 +115,10 @@ VulkanBase::VulkanBase(Model model, const char *title, vec<2, int> size)
   // TODO: dynamic Mesh Loading
   createVertexBuffer();
   createIndexBuffer();
+
+  // Submit all startup transfers at once
+  uploads->flush();
+
   createUniformBuffers();
 
   createDescriptorPool();
@@ -70,31 +132,38 @@ VulkanBase::~VulkanBase() {
 
   cleanupSwapChain();
 
-  // Destroy Sampler
-  vkDestroySampler(device, textureSampler, nullptr);
+  // Evict cached textures (every handle must be gone)
+  delete textures;
+
+  // Destroy everything still waiting on a frame (the device is idle)
+  deletions->flush();
+  readbacks->flush();
+
+  // Destroy Virtual Texture (its feedback readbacks are gone)
+  delete virtualTexture;
+
+  // Destroy Streamed Views & Upload Slices
+  delete streamer;
+
+  // Destroy Samplers
+  delete samplers;
 
   // Destroy Images
   vkDestroyImageView(device, textureImageView, nullptr);
-  vkDestroyImage(device, textureImage, nullptr);
-  vkFreeMemory(device, textureImageMemory, nullptr);
+  allocator->destroyImage(textureImage, textureImageMemory);
 
-  // Destroy Uniform Buffers
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-    vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
-  }
+  // Destroy Uniform Arena
+  delete uniforms;
 
   vkDestroyDescriptorPool(device, descriptorPool, nullptr);
 
   vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
   // Destroy Vertex Buffer & Memory
-  vkDestroyBuffer(device, vertexBuffer, nullptr);
-  vkFreeMemory(device, vertexBufferMemory, nullptr);
+  allocator->destroyBuffer(vertexBuffer, vertexBufferMemory);
 
   // Destroy Index Buffer & Memory
-  vkDestroyBuffer(device, indexBuffer, nullptr);
-  vkFreeMemory(device, indexBufferMemory, nullptr);
+  allocator->destroyBuffer(indexBuffer, indexBufferMemory);
 
   // Destroy Semaphores
   for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -103,7 +172,9 @@ VulkanBase::~VulkanBase() {
     vkDestroyFence(device, inFlightFences[i], nullptr);
   }
 
-  // Destroy Command Pool
+  // Destroy Upload Batch & Command Pools
+  delete uploads;
+  vkDestroyCommandPool(device, transferCommandPool, nullptr);
   vkDestroyCommandPool(device, commandPool, nullptr);
 
   // Destroy Pipeline
@@ -115,6 +186,12 @@ VulkanBase::~VulkanBase() {
   // Destroy Render Pass
   vkDestroyRenderPass(device, renderPass, nullptr);
 
+  // Destroy Staging Ring & Allocator (releases all memory blocks)
+  delete readbacks;
+  delete deletions;
+  delete staging;
+  delete allocator;
+
   // Destroy Logical Device
   vkDestroyDevice(device, nullptr);
 
@@ -132,6 +209,62 @@ bool VulkanBase::update() {
   return window->update();
 }
 
+Allocator::Stats VulkanBase::getMemoryStats() {
+  return allocator->getStats();
+}
+
+std::vector<Allocator::HeapBudget> VulkanBase::getMemoryBudget() {
+  return allocator->getBudget();
+}
+
+std::vector<TextureManager::Handle>
+VulkanBase::acquireTextures(const std::vector<std::string> &paths) {
+  return textures->acquire(paths);
+}
+
+TextureManager::Stats VulkanBase::getTextureStats() {
+  return textures->stats();
+}
+
+void VulkanBase::setSamplerProfile(SamplerProfile profile) {
+  if (profile == samplerProfile)
+    return;
+
+  samplerProfile = profile;
+  textureSampler = samplers->get(profile, static_cast<float>(mipLevels));
+
+  // Each frame's set is rewritten once its frame comes round again (after
+  // its fence, so no set changes under a frame in flight)
+  for (VkImageView &view : descriptorViews)
+    view = VK_NULL_HANDLE;
+}
+
+SamplerProfile VulkanBase::getSamplerProfile() { return samplerProfile; }
+
+float VulkanBase::getMaxAnisotropy() { return samplers->maxAnisotropy(); }
+
+VkFormat VulkanBase::getTextureFormat() { return textureFormat; }
+
+uint32_t VulkanBase::getTextureLevels() { return mipLevels; }
+
+UploadBatch::Stats VulkanBase::getUploadStats() { return uploads->stats(); }
+
+TextureStreamer::Stats VulkanBase::getStreamingStats() {
+  return streamer->stats();
+}
+
+VirtualTexture::Stats VulkanBase::getVirtualTextureStats() {
+  return virtualTexture ? virtualTexture->stats() : VirtualTexture::Stats{};
+}
+
+std::future<std::vector<char>> VulkanBase::capture() {
+  if (!swapChainReadable)
+    throw std::runtime_error("swap chain images can't be read back");
+
+  captures.emplace_back();
+  return captures.back().get_future();
+}
+
 void VulkanBase::createInstance() {
   // Check Validation Layer Availability
   if (enableValidationLayers && !checkValidationLayerSupport())
@@ -144,7 +277,7 @@ void VulkanBase::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_1;
 
   // Instance Creation Info
   VkInstanceCreateInfo createInfo{};
@@ -253,11 +386,7 @@ bool VulkanBase::isDeviceSuitable(VkPhysicalDevice device) {
                         !swapChainSupport.presentModes.empty();
   }
 
-  VkPhysicalDeviceFeatures supportedFeatures;
-  vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-
-  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+  return indices.isComplete() && extensionsSupported && swapChainAdequate;
 }
 
 QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device) {
@@ -272,21 +401,27 @@ QueueFamilyIndices VulkanBase::findQueueFamilies(VkPhysicalDevice device) {
 
   int i = 0;
   for (const auto &queueFamily : queueFamilies) {
-    // Get Graphics Family
-    if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-      indices.graphicsFamily = i;
-
-    // Get Present Family
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, window->surface,
-                                         &presentSupport);
-
-    if (presentSupport)
-      indices.presentFamily = i;
+    if (!indices.isComplete()) {
+      // Get Graphics Family
+      if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        indices.graphicsFamily = i;
+
+      // Get Present Family
+      VkBool32 presentSupport = false;
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, window->surface,
+                                           &presentSupport);
+
+      if (presentSupport)
+        indices.presentFamily = i;
+    }
 
-    // break if complete
-    if (indices.isComplete())
-      break;
+    // Get Transfer Family (prefer pure DMA queues over async compute ones)
+    if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT &&
+        !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+        (!indices.transferFamily ||
+         queueFamilies[indices.transferFamily.value()].queueFlags &
+             VK_QUEUE_COMPUTE_BIT))
+      indices.transferFamily = i;
 
     i++;
   }
@@ -300,6 +435,8 @@ void VulkanBase::createLogicalDevice() {
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
                                             indices.presentFamily.value()};
+  if (indices.transferFamily)
+    uniqueQueueFamilies.insert(indices.transferFamily.value());
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -311,8 +448,40 @@ void VulkanBase::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures{};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+
+  // Anisotropic Filtering (optional, samplers fall back to trilinear)
+  samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+  deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+
+  // Block-Compressed Textures (optional, RGBA8 otherwise)
+  textureCompressionBC = supportedFeatures.textureCompressionBC;
+  deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+  // Virtual Texture Feedback (optional, no virtual texture otherwise)
+  fragmentStoresAndAtomics = supportedFeatures.fragmentStoresAndAtomics;
+  deviceFeatures.fragmentStoresAndAtomics =
+      supportedFeatures.fragmentStoresAndAtomics;
+
+  // Sparse Residency (optional, binds go through the graphics queue)
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                           nullptr);
+
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                           queueFamilies.data());
+
+  sparseResidency =
+      supportedFeatures.sparseBinding &&
+      supportedFeatures.sparseResidencyImage2D &&
+      queueFamilies[indices.graphicsFamily.value()].queueFlags &
+          VK_QUEUE_SPARSE_BINDING_BIT;
+  deviceFeatures.sparseBinding = sparseResidency;
+  deviceFeatures.sparseResidencyImage2D = sparseResidency;
 
   // Create the Logical Device
   VkDeviceCreateInfo createInfo{};
@@ -324,9 +493,21 @@ void VulkanBase::createLogicalDevice() {
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
   // Compatibility Stuff
-  createInfo.enabledExtensionCount =
-      static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  std::vector<const char *> extensions = deviceExtensions;
+
+  // Memory Budget (optional, needs Vulkan 1.1 for the properties2 query)
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+  memoryBudgetSupported =
+      properties.apiVersion >= VK_API_VERSION_1_1 &&
+      checkDeviceExtensionSupport(physicalDevice,
+                                  VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if (memoryBudgetSupported)
+    extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+  createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   if (enableValidationLayers) {
     createInfo.enabledLayerCount =
@@ -343,6 +524,9 @@ void VulkanBase::createLogicalDevice() {
   // Get Device Queue
   vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
   vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+  vkGetDeviceQueue(
+      device, indices.transferFamily.value_or(indices.graphicsFamily.value()),
+      0, &transferQueue);
 }
 
 bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -363,6 +547,23 @@ bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool VulkanBase::checkDeviceExtensionSupport(VkPhysicalDevice device,
+                                             const char *extension) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       availableExtensions.data());
+
+  for (const auto &available : availableExtensions)
+    if (strcmp(available.extensionName, extension) == 0)
+      return true;
+
+  return false;
+}
+
 SwapChainSupportDetails
 VulkanBase::querySwapChainSupport(VkPhysicalDevice device) {
   SwapChainSupportDetails details;
@@ -464,6 +665,12 @@ void VulkanBase::createSwapChain() {
   createInfo.imageArrayLayers = 1;
   createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+  // Allow copying frames out (captures) where the surface supports it
+  swapChainReadable = swapChainSupport.capabilities.supportedUsageFlags &
+                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  if (swapChainReadable)
+    createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
   uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(),
                                    indices.presentFamily.value()};
@@ -484,7 +691,9 @@ void VulkanBase::createSwapChain() {
   createInfo.presentMode = presentMode;
   createInfo.clipped = VK_TRUE;
 
-  createInfo.oldSwapchain = VK_NULL_HANDLE;
+  // Hand over to the previous swap chain (if any), it is retired but its
+  // images may still be in use by frames in flight
+  createInfo.oldSwapchain = swapChain;
 
   if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) !=
       VK_SUCCESS)
@@ -527,7 +736,10 @@ std::vector<char> VulkanBase::readFile(const char *path) {
 void VulkanBase::createGraphicsPipeline() {
   // Load Shaders
   auto vertShaderCode = readFile("../shaders/triangle/vert.spv");
-  auto fragShaderCode = readFile("../shaders/triangle/frag.spv");
+  auto fragShaderCode = readFile(
+      !virtualTexture            ? "../shaders/triangle/frag.spv"
+      : virtualTexture->sparse() ? VIRTUAL_SPARSE_SHADER
+                                 : VIRTUAL_FRAG_SHADER);
 
   VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
   VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -657,13 +869,22 @@ void VulkanBase::createGraphicsPipeline() {
   colorBlending.blendConstants[2] = 0.0f; // optional
   colorBlending.blendConstants[3] = 0.0f; // optional
 
-  // Pipeline Layout
+  // Pipeline Layout (+ virtual texture set & parameters)
+  std::vector<VkDescriptorSetLayout> setLayouts = {descriptorSetLayout};
+
+  VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                                        sizeof(VirtualTexture::Params)};
+
+  if (virtualTexture)
+    setLayouts.push_back(virtualTexture->setLayout);
+
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = 1;
-  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-  pipelineLayoutInfo.pushConstantRangeCount = 0;    // optional
-  pipelineLayoutInfo.pPushConstantRanges = nullptr; // optional
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = virtualTexture ? 1 : 0;
+  pipelineLayoutInfo.pPushConstantRanges =
+      virtualTexture ? &pushConstantRange : nullptr;
 
   if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr,
                              &pipelineLayout) != VK_SUCCESS)
@@ -834,6 +1055,14 @@ void VulkanBase::createCommandPool() {
   if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) !=
       VK_SUCCESS)
     throw std::runtime_error("failed to create comand pool");
+
+  // Transfer Command Pool (uploads are recorded here)
+  poolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value_or(
+      queueFamilyIndices.graphicsFamily.value());
+
+  if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferCommandPool) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create transfer command pool");
 }
 
 void VulkanBase::createCommandBuffers() {
@@ -851,7 +1080,8 @@ void VulkanBase::createCommandBuffers() {
 }
 
 void VulkanBase::recordCommandBuffer(VkCommandBuffer commandBuffer,
-                                     uint32_t imageIndex) {
+                                     uint32_t imageIndex,
+                                     uint32_t uniformOffset) {
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   beginInfo.flags = 0;                  // optional
@@ -860,6 +1090,16 @@ void VulkanBase::recordCommandBuffer(VkCommandBuffer commandBuffer,
   if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
     throw std::runtime_error("failed to begin recording command buffer");
 
+  // Copy staged uniforms (no-op when they are written in place)
+  uniforms->record(commandBuffer);
+
+  // Copy streamed texture levels
+  streamer->record(commandBuffer);
+
+  // Upload streamed tiles & clear the feedback
+  if (virtualTexture)
+    virtualTexture->record(commandBuffer);
+
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
   renderPassInfo.renderPass = renderPass;
@@ -903,12 +1143,38 @@ void VulkanBase::recordCommandBuffer(VkCommandBuffer commandBuffer,
 
   vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           pipelineLayout, 0, 1, &descriptorSets[currentFrame],
-                          0, nullptr);
+                          1, &uniformOffset);
+
+  if (virtualTexture) {
+    uint32_t feedbackOffset = virtualTexture->feedbackOffset();
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pipelineLayout, 1, 1,
+                            &virtualTexture->descriptorSet, 1,
+                            &feedbackOffset);
+
+    VirtualTexture::Params params = virtualTexture->params();
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
+                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(params),
+                       &params);
+  }
   vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(model.indices.size()),
                    1, 0, 0, 0);
 
   vkCmdEndRenderPass(commandBuffer);
 
+  // Read back the tiles this frame wanted
+  if (virtualTexture)
+    virtualTexture->recordFeedback(commandBuffer);
+
+  // Copy out the rendered image for pending captures
+  // (formats picked by chooseSwapSurfaceFormat are 32-bit)
+  for (auto &promise : captures)
+    readbacks->readImage(commandBuffer, frameCount,
+                         swapChainImages[imageIndex],
+                         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, swapChainExtent, 4,
+                         ReadbackQueue::fulfil(std::move(promise)));
+  captures.clear();
+
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
     throw std::runtime_error("failed to record command buffer");
 }
@@ -956,19 +1222,43 @@ void VulkanBase::drawFrame() {
   // Reset InFlightFence
   vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-  vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-  recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+  // Frames up to the one that last used this fence have finished
+  frameCount++;
+  uint64_t completed =
+      frameCount > MAX_FRAMES_IN_FLIGHT ? frameCount - MAX_FRAMES_IN_FLIGHT : 0;
+
+  allocator->beginFrame(frameCount, completed);
+  deletions->collect(completed);
+  readbacks->collect(completed);
 
-  updateUniformBuffer(currentFrame);
+  // Stream texture levels (by the size textures were drawn at last frame)
+  streamer->begin(currentFrame, frameCount);
+  updateDescriptorSet(currentFrame);
+
+  // Stream tiles (binding sparse pages ahead of the frame)
+  VkSemaphore bindSemaphore = VK_NULL_HANDLE;
+  if (virtualTexture) {
+    virtualTexture->begin(currentFrame, frameCount, completed);
+    bindSemaphore = virtualTexture->bind(graphicsQueue);
+  }
+
+  // This frame's arena slice is free once its fence has signaled
+  uniforms->begin(currentFrame);
+  uint32_t uniformOffset = updateUniformBuffer();
+
+  vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+  recordCommandBuffer(commandBuffers[currentFrame], imageIndex, uniformOffset);
 
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame],
+                                  bindSemaphore};
   VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
 
-  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.waitSemaphoreCount = bindSemaphore ? 2 : 1;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
 
@@ -1007,29 +1297,46 @@ void VulkanBase::drawFrame() {
 }
 
 void VulkanBase::cleanupSwapChain() {
-  // Destroy Depth Buffer
-  vkDestroyImageView(device, depthImageView, nullptr);
-  vkDestroyImage(device, depthImage, nullptr);
-  vkFreeMemory(device, depthImageMemory, nullptr);
-
-  // Destroy Framebuffers
-  for (auto framebuffer : swapChainFramebuffers)
-    vkDestroyFramebuffer(device, framebuffer, nullptr);
-
-  // Destroy Image Views
-  for (auto imageView : swapChainImageViews)
-    vkDestroyImageView(device, imageView, nullptr);
+  // Everything is destroyed once the last submitted frame has finished
+  uint64_t frame = frameCount;
+
+  // Destroy Depth Buffer & Transient Attachments
+  VkImageView depthView = depthImageView;
+  TransientPool *oldTransients = transients;
+  deletions->push(frame, [this, depthView, oldTransients]() {
+    vkDestroyImageView(device, depthView, nullptr);
+    delete oldTransients;
+  });
+  transients = nullptr;
+
+  // Destroy Framebuffers & Image Views
+  std::vector<VkFramebuffer> framebuffers = std::move(swapChainFramebuffers);
+  std::vector<VkImageView> imageViews = std::move(swapChainImageViews);
+  swapChainFramebuffers.clear();
+  swapChainImageViews.clear();
+
+  deletions->push(frame, [this, framebuffers, imageViews]() {
+    for (auto framebuffer : framebuffers)
+      vkDestroyFramebuffer(device, framebuffer, nullptr);
+
+    for (auto imageView : imageViews)
+      vkDestroyImageView(device, imageView, nullptr);
+  });
 
   // Destroy Swap Chain
-  vkDestroySwapchainKHR(device, swapChain, nullptr);
+  // (the handle stays valid until then, a new one can still retire it)
+  VkSwapchainKHR oldSwapChain = swapChain;
+  deletions->push(frame, [this, oldSwapChain]() {
+    vkDestroySwapchainKHR(device, oldSwapChain, nullptr);
+  });
 }
 
 void VulkanBase::recreateSwapChain() {
   while (window->size == vec<2, int>{0})
     window->update();
 
-  vkDeviceWaitIdle(device);
-
+  // No device wait, the old resources are destroyed once the frames in
+  // flight have finished with them
   cleanupSwapChain();
 
   createSwapChain();
@@ -1041,117 +1348,66 @@ void VulkanBase::recreateSwapChain() {
 void VulkanBase::createVertexBuffer() {
   uint32_t bufferSize = sizeof(model.vertices[0]) * model.vertices.size();
 
-  // Create Staging Buffer
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingBufferMemory);
-
-  // Copy Vertex Data
-  void *data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, model.vertices.data(), (size_t)bufferSize);
+  for (const Vertex &vertex : model.vertices)
+    modelRadius = std::max(modelRadius, vertex.position.length());
 
-  vkUnmapMemory(device, stagingBufferMemory);
+  // Copy Vertex Data into the Staging Ring
+  StagingRing::Region staged =
+      staging->push(model.vertices.data(), bufferSize);
 
   // Create Vertex Buffer
   createBuffer(
       bufferSize,
       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+      MemoryUsage::Static, vertexBuffer, vertexBufferMemory);
 
-  copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
-}
-
-uint32_t VulkanBase::findMemoryType(uint32_t typeFilter,
-                                    VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-    if (typeFilter & (1 << i) &&
-        (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-      return i;
-
-  throw std::runtime_error("failed to find suitable memory type");
+  copyBuffer(staged.buffer, vertexBuffer, bufferSize, staged.offset);
+  uploads->releaseBuffer(vertexBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
 void VulkanBase::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-                              VkMemoryPropertyFlags properties,
-                              VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
+                              MemoryUsage memoryUsage, VkBuffer &buffer,
+                              Allocation &bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
-    throw std::runtime_error("failed to create buffer");
-
-  VkMemoryRequirements memRequirements;
-  vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) !=
-      VK_SUCCESS)
-    throw std::runtime_error("failed to allocate buffer memory");
-
-  vkBindBufferMemory(device, buffer, bufferMemory, 0);
+  allocator->createBuffer(bufferInfo, memoryUsage, buffer, bufferMemory);
 }
 
 void VulkanBase::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer,
-                            VkDeviceSize size) {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+                            VkDeviceSize size, VkDeviceSize srcOffset) {
+  VkCommandBuffer commandBuffer = uploads->record();
 
   VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0; // optional
+  copyRegion.srcOffset = srcOffset;
   copyRegion.dstOffset = 0; // optional
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-  endSingleTimeCommands(commandBuffer);
 }
 
 void VulkanBase::createIndexBuffer() {
   VkDeviceSize bufferSize = sizeof(model.indices[0]) * model.indices.size();
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingBufferMemory);
-
-  void *data;
-  vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-  memcpy(data, model.indices.data(), (size_t)bufferSize);
-  vkUnmapMemory(device, stagingBufferMemory);
+  StagingRing::Region staged = staging->push(model.indices.data(), bufferSize);
 
   createBuffer(
       bufferSize,
       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-
-  copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+      MemoryUsage::Static, indexBuffer, indexBufferMemory);
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+  copyBuffer(staged.buffer, indexBuffer, bufferSize, staged.offset);
+  uploads->releaseBuffer(indexBuffer, VK_ACCESS_INDEX_READ_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 }
 
 void VulkanBase::createDescriptorSetLayout() {
   VkDescriptorSetLayoutBinding uboLayoutBinding{};
   uboLayoutBinding.binding = 0;
-  uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+  uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
   uboLayoutBinding.descriptorCount = 1;
   uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
   uboLayoutBinding.pImmutableSamplers = nullptr; // optional
@@ -1178,24 +1434,10 @@ void VulkanBase::createDescriptorSetLayout() {
 }
 
 void VulkanBase::createUniformBuffers() {
-  VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-
-  uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-  uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                 uniformBuffers[i], uniformBuffersMemory[i]);
-
-    vkMapMemory(device, uniformBuffersMemory[i], 0, bufferSize, 0,
-                &uniformBuffersMapped[i]);
-  }
+  uniforms = new UniformArena(physicalDevice, allocator, MAX_FRAMES_IN_FLIGHT);
 }
 
-void VulkanBase::updateUniformBuffer(uint32_t currentImage) {
+uint32_t VulkanBase::updateUniformBuffer() {
   static float startTime = time();
 
   float now = time() - startTime;
@@ -1212,21 +1454,39 @@ void VulkanBase::updateUniformBuffer(uint32_t currentImage) {
       1000.0f);
   ubo.projection(1, 1) *= -1;
 
-  memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+  // Screen-space size of the texture, for streaming from the next frame
+  // (the model is UV-mapped all around, so the texture spans about its
+  // projected circumference; rows are points, translation is the last row)
+  if (streamedTexture >= 0) {
+    vec<4> origin(0.0f, 0.0f, 0.0f, 1.0f);
+    for (uint8_t c = 0; c < 4; c++)
+      origin[c] = model.data[3][0] * ubo.view.data[0][c] +
+                  model.data[3][1] * ubo.view.data[1][c] +
+                  model.data[3][2] * ubo.view.data[2][c] +
+                  ubo.view.data[3][c];
+
+    float depth = std::max(std::fabs(origin[2]), 0.1f);
+    float radius = modelRadius * std::fabs(ubo.projection(1, 1)) / depth *
+                   swapChainExtent.height * 0.5f;
+
+    streamer->report(streamedTexture, 2.0f * 3.14159265f * radius);
+  }
+
+  return uniforms->push(ubo);
 }
 
 void VulkanBase::createDescriptorPool() {
   std::array<VkDescriptorPoolSize, 2> poolSizes{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
   poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   poolInfo.pPoolSizes = poolSizes.data();
-  poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
 
   if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) !=
       VK_SUCCESS)
@@ -1234,175 +1494,535 @@ void VulkanBase::createDescriptorPool() {
 }
 
 void VulkanBase::createDescriptorSets() {
+  // A set per frame in flight (the frame's uniform slice is picked by the
+  // dynamic offset)
   std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT,
                                              descriptorSetLayout);
 
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = descriptorPool;
-  allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  allocInfo.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
   allocInfo.pSetLayouts = layouts.data();
 
   descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+  descriptorViews.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+
   if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) !=
       VK_SUCCESS)
     throw std::runtime_error("failed to allocate descriptor sets");
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = uniformBuffers[i];
-    bufferInfo.offset = 0;
-    bufferInfo.range = sizeof(UniformBufferObject);
-
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = textureImageView;
-    imageInfo.sampler = textureSampler;
-
-    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = descriptorSets[i];
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[1].dstSet = descriptorSets[i];
-    descriptorWrites[1].dstBinding = 1;
-    descriptorWrites[1].dstArrayElement = 0;
-    descriptorWrites[1].descriptorType =
-        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[1].descriptorCount = 1;
-    descriptorWrites[1].pImageInfo = &imageInfo;
-
-    vkUpdateDescriptorSets(device,
-                           static_cast<uint32_t>(descriptorWrites.size()),
-                           descriptorWrites.data(), 0, nullptr);
+  VkDescriptorBufferInfo bufferInfo{};
+  bufferInfo.buffer = uniforms->buffer;
+  bufferInfo.offset = 0;
+  bufferInfo.range = sizeof(UniformBufferObject);
+
+  for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSets[frame];
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType =
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+    updateDescriptorSet(frame);
   }
 }
 
-void VulkanBase::createTextureImage() {
-  int width, height, channels;
-  stbi_uc *pixels = stbi_load("../../res/earth.png", &width, &height, &channels,
-                              STBI_rgb_alpha);
+void VulkanBase::updateDescriptorSet(uint32_t frame) {
+  VkImageView view = textureView();
+  if (descriptorViews[frame] == view)
+    return;
 
-  VkDeviceSize imageSize = width * height * channels;
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView = view;
+  imageInfo.sampler = textureSampler;
+
+  VkWriteDescriptorSet descriptorWrite{};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstSet = descriptorSets[frame];
+  descriptorWrite.dstBinding = 1;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pImageInfo = &imageInfo;
+
+  vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+  descriptorViews[frame] = view;
+}
 
-  if (!pixels)
-    throw std::runtime_error("failed to load texture image");
+VkImageView VulkanBase::textureView() {
+  return streamedTexture >= 0 ? streamer->view(streamedTexture)
+                              : textureImageView;
+}
 
-  VkBuffer stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
+bool VulkanBase::createTextureImageKtx2(const char *path) {
+  std::shared_ptr<Ktx2Texture> texture;
+  try {
+    texture = std::make_shared<Ktx2Texture>(path);
+  } catch (const std::exception &) {
+    return false;
+  }
 
-  createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                   VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               stagingBuffer, stagingBufferMemory);
+  bool blockCompressed = texture->format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK &&
+                         texture->format <= VK_FORMAT_BC7_SRGB_BLOCK;
 
-  void *data;
-  vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, pixels, static_cast<size_t>(imageSize));
-  vkUnmapMemory(device, stagingBufferMemory);
+  if ((blockCompressed && !textureCompressionBC) ||
+      !supportsFormat(texture->format,
+                      VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                          VK_FORMAT_FEATURE_TRANSFER_DST_BIT))
+    return false;
 
-  stbi_image_free(pixels);
+  textureFormat = texture->format;
+  mipLevels = texture->levels.size();
 
-  createImage(width, height, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
+  createImage(texture->width, texture->height, mipLevels, textureFormat,
+              VK_IMAGE_TILING_OPTIMAL,
               VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage,
-              textureImageMemory);
+              MemoryUsage::Static, textureImage, textureImageMemory);
 
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
+  transitionImageLayout(textureImage, textureFormat,
                         VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+  // Only the smallest levels are uploaded up front, the streamer refines the
+  // texture from there (levels are copied from the mapped file as stored)
+  uint32_t resident = mipLevels - 1;
+  while (resident > 0 &&
+         std::max(texture->levels[resident - 1].width,
+                  texture->levels[resident - 1].height) <= STREAMING_TAIL_SIZE)
+    resident--;
+
+  for (uint32_t level = resident; level < mipLevels; level++) {
+    const Ktx2Texture::Level &data = texture->levels[level];
+
+    StagingRing::Region staged = staging->push(data.data, data.size);
+    copyBufferToImage(staged.buffer, textureImage, data.width, data.height,
+                      staged.offset, level);
+  }
 
-  copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(width),
-                    static_cast<uint32_t>(height));
+  // (levels still to come are discarded by the streamer before their copy)
+  uploads->releaseImage(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        VK_ACCESS_SHADER_READ_BIT,
+                        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, mipLevels);
 
-  transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  streamedTexture = static_cast<int32_t>(
+      streamer->add(textureImage, TextureStreamer::fromKtx2(texture),
+                    resident));
 
-  vkDestroyBuffer(device, stagingBuffer, nullptr);
-  vkFreeMemory(device, stagingBufferMemory, nullptr);
+  return true;
 }
 
-void VulkanBase::createImage(uint32_t width, uint32_t height, VkFormat format,
-                             VkImageTiling tiling, VkImageUsageFlags usage,
-                             VkMemoryPropertyFlags properties, VkImage &image,
-                             VkDeviceMemory &imageMemory) {
-  VkImageCreateInfo imageInfo{};
-  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-  imageInfo.imageType = VK_IMAGE_TYPE_2D;
-  imageInfo.extent.width = width;
-  imageInfo.extent.height = height;
-  imageInfo.extent.depth = 1;
-  imageInfo.mipLevels = 1;
-  imageInfo.arrayLayers = 1;
+void VulkanBase::createTextureImage() {
+  // Prefer the cooked texture (pre-mipped & pre-compressed, no decoding)
+  if (createTextureImageKtx2("../../res/earth.ktx2"))
+    return;
 
-  imageInfo.format = format;
-  imageInfo.tiling = tiling;
-  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  imageInfo.usage = usage;
-  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  ImageDecoder::Job job;
+  job.path = "../../res/earth.png";
 
-  if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
-    throw std::runtime_error("failed to create image");
+  if (!ImageDecoder::probe(job))
+    throw std::runtime_error("failed to load texture image");
 
-  VkMemoryRequirements memRequirements;
-  vkGetImageMemoryRequirements(device, image, &memRequirements);
+  // Colour images are uploaded as BC7 blocks where they can be sampled (a
+  // quarter of the memory, the chain is built & encoded on the CPU)
+  if (job.format == ImageDecoder::Format::RGBA8 && textureCompressionBC &&
+      supportsFormat(VK_FORMAT_BC7_SRGB_BLOCK,
+                     VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+                         VK_FORMAT_FEATURE_TRANSFER_DST_BIT)) {
+    Image image;
+    image.width = job.width;
+    image.height = job.height;
+    image.pixels.resize(job.size());
+    job.dst = image.pixels.data();
+
+    if (!ImageDecoder::decode(job))
+      throw std::runtime_error("failed to load texture image");
+
+    image.generateMips();
+    CompressedImage compressed =
+        CompressedImage::encode(image, BlockFormat::BC7);
+
+    textureFormat = VK_FORMAT_BC7_SRGB_BLOCK;
+    mipLevels = image.mipLevels;
+
+    StagingRing::Region staged =
+        staging->push(compressed.data.data(), compressed.data.size());
+
+    createImage(image.width, image.height, mipLevels, textureFormat,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                MemoryUsage::Static, textureImage, textureImageMemory);
+
+    transitionImageLayout(textureImage, textureFormat,
+                          VK_IMAGE_LAYOUT_UNDEFINED,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+
+    for (uint32_t level = 0; level < mipLevels; level++)
+      copyBufferToImage(staged.buffer, textureImage, image.levelWidth(level),
+                        image.levelHeight(level),
+                        staged.offset + compressed.levelOffset(level), level);
+
+    // Transition to shader reads on the graphics queue
+    uploads->releaseImage(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                          VK_ACCESS_SHADER_READ_BIT,
+                          VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, mipLevels);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memRequirements.memoryTypeBits, properties);
+    return;
+  }
 
-  if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    throw std::runtime_error("failed to allocate image memory");
+  // Everything else keeps the format it decodes to (R8, RG8, RGBA8 or
+  // RGBA16F), see loadTextures
+  Texture texture = loadTextures({job.path})[0];
+  if (!texture.image)
+    throw std::runtime_error("failed to load texture image");
 
-  vkBindImageMemory(device, image, imageMemory, 0);
+  textureImage = texture.image;
+  textureImageMemory = texture.memory;
+  textureImageView = texture.view;
+  textureFormat = texture.format;
+  mipLevels = texture.mipLevels;
 }
 
-VkCommandBuffer VulkanBase::beginSingleTimeCommands() {
-  VkCommandBufferAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = commandPool;
-  allocInfo.commandBufferCount = 1;
+std::vector<Texture>
+VulkanBase::loadTextures(const std::vector<std::string> &paths, bool srgb) {
+  std::vector<Texture> textures(paths.size());
 
-  VkCommandBuffer commandBuffer;
-  vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+  std::vector<ImageDecoder::Job> jobs(paths.size());
+  for (size_t i = 0; i < paths.size(); i++)
+    jobs[i].path = paths[i];
 
-  VkCommandBufferBeginInfo beginInfo{};
-  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  // Read every header first to size the staging regions (& pick formats)
+  ImageDecoder::probe(jobs);
+
+  // RGBA8 without linear blits: decoded as RGBA8 & chained on the CPU
+  VkFormat colorFormat =
+      srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  bool colorBlit = supportsLinearBlit(colorFormat);
 
-  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  // Other formats without linear blits: expanded to RGBA8, kept linear
+  VkFormat dataFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  bool dataBlit = supportsLinearBlit(dataFormat);
+
+  // Chains are blitted on the GPU if possible, else built on the CPU
+  std::vector<VkFormat> formats(paths.size());
+  std::vector<bool> blits(paths.size());
+  std::vector<Image> chains(paths.size());
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    switch (jobs[i].format) {
+    case ImageDecoder::Format::R8:
+      formats[i] = VK_FORMAT_R8_UNORM;
+      break;
+    case ImageDecoder::Format::RG8:
+      formats[i] = VK_FORMAT_R8G8_UNORM;
+      break;
+    case ImageDecoder::Format::RGBA8:
+      formats[i] = colorFormat;
+      break;
+    case ImageDecoder::Format::RGBA16F:
+      formats[i] = VK_FORMAT_R16G16B16A16_SFLOAT;
+      break;
+    }
+
+    blits[i] = formats[i] == colorFormat ? colorBlit
+                                         : supportsLinearBlit(formats[i]);
+
+    if (!blits[i] && formats[i] != colorFormat) {
+      jobs[i].expand = true;
+      ImageDecoder::probe(jobs[i]);
+      formats[i] = dataFormat;
+      blits[i] = dataBlit;
+    }
+
+    chains[i].width = jobs[i].width;
+    chains[i].height = jobs[i].height;
+    chains[i].mipLevels = Image::fullMipLevels(jobs[i].width, jobs[i].height);
+  }
 
-  return commandBuffer;
+  std::vector<StagingRing::Region> regions(paths.size());
+
+  for (size_t first = 0; first < paths.size();) {
+    // Reserve a wave of regions (at least one image)
+    size_t last = first;
+    for (VkDeviceSize bytes = 0; last < paths.size(); last++) {
+      if (!jobs[last].valid)
+        continue;
+
+      VkDeviceSize size = blits[last] ? jobs[last].size()
+                                      : chains[last].levelOffset(
+                                            chains[last].mipLevels);
+      if (bytes && bytes + size > TEXTURE_WAVE_SIZE)
+        break;
+
+      regions[last] = allocateStaging(size);
+      bytes += size;
+
+      if (blits[last])
+        jobs[last].dst = regions[last].mapped;
+    }
+
+    // Decode the wave on every thread
+    // (level 0 lands in the staging ring, CPU-built chains are copied in)
+    parallelFor(last - first, [&](size_t begin, size_t end) {
+      for (size_t i = first + begin; i < first + end; i++) {
+        if (!jobs[i].valid || blits[i]) {
+          ImageDecoder::decode(jobs[i]);
+          continue;
+        }
+
+        Image &chain = chains[i];
+        chain.pixels.resize(chain.levelOffset(chain.mipLevels));
+        chain.mipLevels = 1;
+
+        jobs[i].dst = chain.pixels.data();
+        if (ImageDecoder::decode(jobs[i])) {
+          chain.generateMips(formats[i] == VK_FORMAT_R8G8B8A8_SRGB);
+          memcpy(regions[i].mapped, chain.pixels.data(),
+                 chain.pixels.size());
+        }
+
+        chain.pixels = std::vector<uint8_t>();
+      }
+    });
+
+    // Record the uploads of the wave
+    for (size_t i = first; i < last; i++) {
+      if (!jobs[i].decoded)
+        continue;
+
+      Texture &texture = textures[i];
+      VkFormat format = formats[i];
+      bool blit = blits[i];
+
+      texture.format = format;
+      texture.width = jobs[i].width;
+      texture.height = jobs[i].height;
+      texture.mipLevels = Image::fullMipLevels(texture.width, texture.height);
+
+      // (blitted chains read each level back as the source of the next)
+      VkImageUsageFlags usage =
+          VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+      if (blit)
+        usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+      createImage(texture.width, texture.height, texture.mipLevels, format,
+                  VK_IMAGE_TILING_OPTIMAL, usage, MemoryUsage::Static,
+                  texture.image, texture.memory);
+
+      transitionImageLayout(texture.image, format, VK_IMAGE_LAYOUT_UNDEFINED,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            texture.mipLevels);
+
+      if (blit) {
+        copyBufferToImage(regions[i].buffer, texture.image, texture.width,
+                          texture.height, regions[i].offset);
+
+        uploads->releaseImage(
+            texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, texture.mipLevels);
+
+        generateMipmaps(texture.image, texture.width, texture.height,
+                        texture.mipLevels);
+      } else {
+        for (uint32_t level = 0; level < texture.mipLevels; level++)
+          copyBufferToImage(regions[i].buffer, texture.image,
+                            chains[i].levelWidth(level),
+                            chains[i].levelHeight(level),
+                            regions[i].offset + chains[i].levelOffset(level),
+                            level);
+
+        uploads->releaseImage(texture.image,
+                              VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                              VK_ACCESS_SHADER_READ_BIT,
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                              texture.mipLevels);
+      }
+
+      texture.view = createImageView(texture.image, format,
+                                     VK_IMAGE_ASPECT_COLOR_BIT,
+                                     texture.mipLevels);
+    }
+
+    // The wave's regions are reclaimed once its transfers finish
+    submitUploads();
+    first = last;
+  }
+
+  return textures;
 }
 
-void VulkanBase::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-  vkEndCommandBuffer(commandBuffer);
+Texture VulkanBase::loadAtlas(const std::vector<std::string> &paths,
+                              std::vector<TextureAtlas::Region> &regions,
+                              TextureAtlas::Mode mode, bool srgb) {
+  std::vector<ImageDecoder::Job> jobs(paths.size());
+  std::vector<Image> images(paths.size());
 
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = &commandBuffer;
+  // Decoded as RGBA8, the layers' chains are built on the CPU
+  for (size_t i = 0; i < paths.size(); i++) {
+    jobs[i].path = paths[i];
+    jobs[i].expand = true;
+  }
+
+  ImageDecoder::probe(jobs);
+
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!jobs[i].valid)
+      throw std::runtime_error("failed to load atlas image");
+
+    images[i].width = jobs[i].width;
+    images[i].height = jobs[i].height;
+    images[i].pixels.resize(jobs[i].size());
+    jobs[i].dst = images[i].pixels.data();
+  }
+
+  ImageDecoder::decode(jobs);
+
+  for (const ImageDecoder::Job &job : jobs)
+    if (!job.decoded)
+      throw std::runtime_error("failed to load atlas image");
+
+  TextureAtlas atlas = TextureAtlas::pack(images, srgb, mode);
+  images.clear();
+
+  Texture texture;
+  if (atlas.layers.empty())
+    return texture;
 
-  vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue);
+  texture.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  texture.width = atlas.width;
+  texture.height = atlas.height;
+  texture.mipLevels = atlas.mipLevels;
+  texture.layers = static_cast<uint32_t>(atlas.layers.size());
 
-  vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+  createImage(texture.width, texture.height, texture.mipLevels,
+              texture.format, VK_IMAGE_TILING_OPTIMAL,
+              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+              MemoryUsage::Static, texture.image, texture.memory,
+              texture.layers);
+
+  transitionImageLayout(texture.image, texture.format,
+                        VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        texture.mipLevels, texture.layers);
+
+  // One submission per layer keeps the staging ring from filling up
+  for (uint32_t layer = 0; layer < texture.layers; layer++) {
+    const Image &chain = atlas.layers[layer];
+
+    StagingRing::Region staged = allocateStaging(chain.pixels.size());
+    memcpy(staged.mapped, chain.pixels.data(), chain.pixels.size());
+
+    for (uint32_t level = 0; level < texture.mipLevels; level++)
+      copyBufferToImage(staged.buffer, texture.image, chain.levelWidth(level),
+                        chain.levelHeight(level),
+                        staged.offset + chain.levelOffset(level), level,
+                        layer);
+
+    if (layer + 1 == texture.layers)
+      uploads->releaseImage(texture.image,
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_ACCESS_SHADER_READ_BIT,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                            texture.mipLevels, texture.layers);
+
+    submitUploads();
+  }
+
+  // (a single layer is viewed as a plain 2D texture, e.g. for sampler2D)
+  texture.view = createImageView(
+      texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT,
+      texture.mipLevels,
+      texture.layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
+      texture.layers);
+
+  regions = std::move(atlas.regions);
+  return texture;
+}
+
+StagingRing::Region VulkanBase::allocateStaging(VkDeviceSize size) {
+  if (size <= staging->size())
+    return staging->allocate(size);
+
+  VkBuffer buffer;
+  Allocation memory;
+  createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::Staging,
+               buffer, memory);
+
+  stagingBuffers.push_back({buffer, memory});
+  return {buffer, 0, memory.mapped};
+}
+
+void VulkanBase::submitUploads() {
+  if (stagingBuffers.empty()) {
+    uploads->submit();
+    return;
+  }
+
+  uploads->flush();
+
+  for (auto &[buffer, memory] : stagingBuffers)
+    allocator->destroyBuffer(buffer, memory);
+  stagingBuffers.clear();
+}
+
+void VulkanBase::destroyTexture(Texture &texture) {
+  if (!texture.image)
+    return;
+
+  VkImage image = texture.image;
+  Allocation memory = texture.memory;
+  VkImageView view = texture.view;
+
+  deletions->push(frameCount, [this, image, memory, view]() mutable {
+    vkDestroyImageView(device, view, nullptr);
+    allocator->destroyImage(image, memory);
+  });
+
+  texture = Texture();
+}
+
+void VulkanBase::createImage(uint32_t width, uint32_t height,
+                             uint32_t mipLevels, VkFormat format,
+                             VkImageTiling tiling, VkImageUsageFlags usage,
+                             MemoryUsage memoryUsage, VkImage &image,
+                             Allocation &imageMemory, uint32_t arrayLayers) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = width;
+  imageInfo.extent.height = height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = mipLevels;
+  imageInfo.arrayLayers = arrayLayers;
+
+  imageInfo.format = format;
+  imageInfo.tiling = tiling;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = usage;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  allocator->createImage(imageInfo, memoryUsage, image, imageMemory);
 }
 
 void VulkanBase::transitionImageLayout(VkImage image, VkFormat format,
                                        VkImageLayout oldLayout,
-                                       VkImageLayout newLayout) {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+                                       VkImageLayout newLayout,
+                                       uint32_t mipLevels, uint32_t layers) {
+  VkCommandBuffer commandBuffer = uploads->record();
 
   VkImageMemoryBarrier barrier{};
   barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -1414,9 +2034,9 @@ void VulkanBase::transitionImageLayout(VkImage image, VkFormat format,
   barrier.image = image;
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = mipLevels;
   barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
+  barrier.subresourceRange.layerCount = layers;
 
   VkPipelineStageFlags sourceStage;
   VkPipelineStageFlags destinationStage;
@@ -1429,7 +2049,7 @@ void VulkanBase::transitionImageLayout(VkImage image, VkFormat format,
     sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
     destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
   } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+             newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
@@ -1440,22 +2060,22 @@ void VulkanBase::transitionImageLayout(VkImage image, VkFormat format,
 
   vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0,
                        nullptr, 0, nullptr, 1, &barrier);
-
-  endSingleTimeCommands(commandBuffer);
 }
 
 void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image,
-                                   uint32_t width, uint32_t height) {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+                                   uint32_t width, uint32_t height,
+                                   VkDeviceSize bufferOffset,
+                                   uint32_t mipLevel, uint32_t layer) {
+  VkCommandBuffer commandBuffer = uploads->record();
 
   VkBufferImageCopy region{};
-  region.bufferOffset = 0;
+  region.bufferOffset = bufferOffset;
   region.bufferRowLength = 0;
   region.bufferImageHeight = 0;
 
   region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel = 0;
-  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.mipLevel = mipLevel;
+  region.imageSubresource.baseArrayLayer = layer;
   region.imageSubresource.layerCount = 1;
 
   region.imageOffset = {0, 0, 0};
@@ -1463,22 +2083,116 @@ void VulkanBase::copyBufferToImage(VkBuffer buffer, VkImage image,
 
   vkCmdCopyBufferToImage(commandBuffer, buffer, image,
                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
-  endSingleTimeCommands(commandBuffer);
+bool VulkanBase::supportsFormat(VkFormat format,
+                                VkFormatFeatureFlags features) {
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+  return (properties.optimalTilingFeatures & features) == features;
+}
+
+bool VulkanBase::supportsLinearBlit(VkFormat format) {
+  return supportsFormat(format,
+                        VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                            VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+}
+
+void VulkanBase::generateMipmaps(VkImage image, int32_t width, int32_t height,
+                                 uint32_t mipLevels) {
+  uploads->recordGraphics([=](VkCommandBuffer commandBuffer) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    int32_t mipWidth = width, mipHeight = height;
+
+    for (uint32_t i = 1; i < mipLevels; i++) {
+      // Previous level becomes the blit source
+      barrier.subresourceRange.baseMipLevel = i - 1;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                           nullptr, 1, &barrier);
+
+      int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+      int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+      VkImageBlit blit{};
+      blit.srcOffsets[0] = {0, 0, 0};
+      blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+      blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.srcSubresource.mipLevel = i - 1;
+      blit.srcSubresource.baseArrayLayer = 0;
+      blit.srcSubresource.layerCount = 1;
+
+      blit.dstOffsets[0] = {0, 0, 0};
+      blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+      blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      blit.dstSubresource.mipLevel = i;
+      blit.dstSubresource.baseArrayLayer = 0;
+      blit.dstSubresource.layerCount = 1;
+
+      vkCmdBlitImage(commandBuffer, image,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+                     VK_FILTER_LINEAR);
+
+      // Previous level is done
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0,
+                           nullptr, 0, nullptr, 1, &barrier);
+
+      mipWidth = nextWidth;
+      mipHeight = nextHeight;
+    }
+
+    // Last level was only written
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+  });
 }
 
 VkImageView VulkanBase::createImageView(VkImage image, VkFormat format,
-                                        VkImageAspectFlags aspectFlags) {
+                                        VkImageAspectFlags aspectFlags,
+                                        uint32_t mipLevels,
+                                        VkImageViewType viewType,
+                                        uint32_t layers) {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = image;
-  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.viewType = viewType;
   viewInfo.format = format;
   viewInfo.subresourceRange.aspectMask = aspectFlags;
   viewInfo.subresourceRange.baseMipLevel = 0;
-  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.levelCount = mipLevels;
   viewInfo.subresourceRange.baseArrayLayer = 0;
-  viewInfo.subresourceRange.layerCount = 1;
+  viewInfo.subresourceRange.layerCount = layers;
 
   VkImageView imageView;
   if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
@@ -1488,49 +2202,61 @@ VkImageView VulkanBase::createImageView(VkImage image, VkFormat format,
 }
 
 void VulkanBase::createTextureImageView() {
-  textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+  // (streamed & decoded textures already have their views)
+  if (streamedTexture >= 0 || textureImageView)
+    return;
+
+  textureImageView = createImageView(textureImage, textureFormat,
+                                     VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
 }
 
 void VulkanBase::createTextureSampler() {
-  VkSamplerCreateInfo samplerInfo{};
-  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  samplerInfo.magFilter = VK_FILTER_LINEAR;
-  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  textureSampler =
+      samplers->get(samplerProfile, static_cast<float>(mipLevels));
+}
 
-  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+void VulkanBase::createVirtualTexture(const char *path) {
+  if (!fragmentStoresAndAtomics || !std::ifstream(path))
+    return;
 
-  VkPhysicalDeviceProperties properties{};
-  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  // (built without glslc, CMake warns about it)
+  if (!VIRTUAL_FRAG_SHADER || !std::ifstream(VIRTUAL_FRAG_SHADER))
+    return;
 
-  // TODO: Turn off if wanted
-  samplerInfo.anisotropyEnable = VK_TRUE;
-  samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+  VirtualTexture::Options options;
+  options.sparse = sparseResidency && std::ifstream(VIRTUAL_SPARSE_SHADER);
 
-  samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  virtualTexture =
+      new VirtualTexture(physicalDevice, device, allocator, readbacks, path,
+                         MAX_FRAMES_IN_FLIGHT, options);
+}
 
-  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+void VulkanBase::createDepthResources() {
+  VkFormat depthFormat = findDepthFormat();
 
-  samplerInfo.compareEnable = VK_FALSE;
-  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  transients = new TransientPool(device, allocator);
 
-  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-  samplerInfo.mipLodBias = 0.0f;
-  samplerInfo.minLod = 0.0f;
-  samplerInfo.maxLod = 0.0f;
+  // Depth is only used by the main pass & never stored
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = swapChainExtent.width;
+  imageInfo.extent.height = swapChainExtent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
 
-  if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) !=
-      VK_SUCCESS)
-    throw std::runtime_error("failed to create texture sampler");
-}
+  imageInfo.format = depthFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-void VulkanBase::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat();
-  createImage(
-      swapChainExtent.width, swapChainExtent.height, depthFormat,
-      VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+  depthImage = transients->add(imageInfo, 0, 0);
+
+  transients->build();
 
   depthImageView =
       createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
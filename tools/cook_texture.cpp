@@ -0,0 +1,104 @@
+// Texture Cooker
+//
+// Builds the full mip chain of an image, block-compresses it & writes it as
+// a KTX2 container, so loading it at runtime decodes no pixels.
+//
+// usage: cook_texture <input> <output.ktx2> [--format bc1|bc3|bc5|bc7|rgba8]
+//                     [--linear] [--zlib|--zstd]
+
+#include <types/bc.hpp>
+#include <types/image.hpp>
+#include <types/ktx2.hpp>
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+static int usage() {
+  fprintf(stderr, "usage: cook_texture <input> <output.ktx2> "
+                  "[--format bc1|bc3|bc5|bc7|rgba8] [--linear] "
+                  "[--zlib|--zstd]\n");
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3)
+    return usage();
+
+  const char *input = argv[1], *output = argv[2];
+
+  const char *format = "bc7";
+  bool srgb = true;
+  Ktx2Texture::Supercompression scheme = Ktx2Texture::None;
+
+  for (int i = 3; i < argc; i++) {
+    if (!strcmp(argv[i], "--format") && i + 1 < argc)
+      format = argv[++i];
+    else if (!strcmp(argv[i], "--linear"))
+      srgb = false;
+    else if (!strcmp(argv[i], "--zlib"))
+      scheme = Ktx2Texture::Zlib;
+    else if (!strcmp(argv[i], "--zstd"))
+      scheme = Ktx2Texture::Zstandard;
+    else
+      return usage();
+  }
+
+  if (!Ktx2Texture::supports(scheme)) {
+    fprintf(stderr, "supercompression is not supported by this build\n");
+    return 1;
+  }
+
+  int width, height, channels;
+  stbi_uc *pixels =
+      stbi_load(input, &width, &height, &channels, STBI_rgb_alpha);
+
+  if (!pixels) {
+    fprintf(stderr, "failed to load %s\n", input);
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  Image image(width, height, pixels);
+  stbi_image_free(pixels);
+
+  // BC5 holds two linear channels (normal maps)
+  image.generateMips(srgb && strcmp(format, "bc5"));
+
+  try {
+    if (!strcmp(format, "rgba8"))
+      Ktx2Texture::write(output, image, srgb, scheme);
+    else {
+      BlockFormat blockFormat;
+      if (!strcmp(format, "bc1"))
+        blockFormat = BlockFormat::BC1;
+      else if (!strcmp(format, "bc3"))
+        blockFormat = BlockFormat::BC3;
+      else if (!strcmp(format, "bc5"))
+        blockFormat = BlockFormat::BC5;
+      else if (!strcmp(format, "bc7"))
+        blockFormat = BlockFormat::BC7;
+      else
+        return usage();
+
+      Ktx2Texture::write(output, CompressedImage::encode(image, blockFormat),
+                         srgb, scheme);
+    }
+  } catch (const std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  printf("%s: %dx%d, %u mip levels, %s, cooked in %.2f s\n", output, width,
+         height, image.mipLevels, format, seconds);
+
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Texture Tiler
+//
+// Cuts an image into the tiled file virtual textures stream from: every
+// level of its mip chain in square tiles with a border, optionally
+// block-compressed. Extents must be powers of two (e.g. 32768x16384
+// equirectangular maps, which should use --wrap).
+//
+// stb_image can't decode images of 2 GB or more (e.g. a 32768x16384 RGBA
+// map), so sources that large are given as several horizontal strips of the
+// same width, top to bottom; they are decoded one at a time into the
+// source, which is then tiled in place.
+//
+// usage: tile_texture <input>... <output.vtex> [--format bc7|rgba8]
+//                     [--tile 128] [--border 4] [--wrap] [--linear]
+
+#include <types/vtex.hpp>
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+static int usage() {
+  fprintf(stderr, "usage: tile_texture <input>... <output.vtex> "
+                  "[--format bc7|rgba8] [--tile 128] [--border 4] [--wrap] "
+                  "[--linear]\n");
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  std::vector<const char *> paths;
+
+  bool bc7 = true, srgb = true, wrap = false;
+  uint32_t tile = 128, border = 4;
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--", 2))
+      paths.push_back(argv[i]);
+    else if (!strcmp(argv[i], "--format") && i + 1 < argc) {
+      i++;
+      if (!strcmp(argv[i], "rgba8") || !strcmp(argv[i], "bc7"))
+        bc7 = !strcmp(argv[i], "bc7");
+      else
+        return usage();
+    } else if (!strcmp(argv[i], "--tile") && i + 1 < argc)
+      tile = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--border") && i + 1 < argc)
+      border = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--wrap"))
+      wrap = true;
+    else if (!strcmp(argv[i], "--linear"))
+      srgb = false;
+    else
+      return usage();
+  }
+
+  if (paths.size() < 2)
+    return usage();
+
+  const char *output = paths.back();
+  paths.pop_back();
+
+  // Strips are stacked into one source, sized from their headers first
+  int width = 0, height = 0;
+  for (const char *path : paths) {
+    int w, h, channels;
+    if (!stbi_info(path, &w, &h, &channels) || (width && w != width)) {
+      fprintf(stderr, "failed to load %s: %s\n", path,
+              width && w != width ? "strips differ in width"
+                                  : stbi_failure_reason());
+      return 1;
+    }
+
+    width = w;
+    height += h;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<uint8_t> source(size_t(width) * height * 4);
+  size_t offset = 0;
+
+  for (const char *path : paths) {
+    int w, h, channels;
+    stbi_uc *pixels = stbi_load(path, &w, &h, &channels, STBI_rgb_alpha);
+
+    if (!pixels || w != width || offset + size_t(w) * h * 4 > source.size()) {
+      fprintf(stderr, "failed to load %s: %s\n", path,
+              pixels ? "strip changed while loading" : stbi_failure_reason());
+      stbi_image_free(pixels);
+      return 1;
+    }
+
+    memcpy(&source[offset], pixels, size_t(w) * h * 4);
+    offset += size_t(w) * h * 4;
+    stbi_image_free(pixels);
+  }
+
+  try {
+    TiledTexture::write(output, source.data(), width, height, srgb, bc7,
+                        tile, border, wrap);
+  } catch (const std::exception &e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  source = std::vector<uint8_t>();
+
+  TiledTexture tiled(output);
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  printf("%s: %dx%d, %u levels, %u tiles of %u+%u texels, %s, tiled in "
+         "%.2f s\n",
+         output, width, height, tiled.header.levels, tiled.tileCount(), tile,
+         2 * border, bc7 ? "bc7" : "rgba8", seconds);
+
+  return 0;
+}